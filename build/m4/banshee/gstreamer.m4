@@ -24,6 +24,15 @@ AC_DEFUN([BANSHEE_CHECK_GSTREAMER],
 		AC_MSG_RESULT([no])
 	fi
 	
+	dnl Gapless playback needs playbin2's about-to-finish signal
+	PKG_CHECK_MODULES(GST_GAPLESS, gstreamer-plugins-base-0.10 >= 0.10.26,
+		enable_gapless=yes, enable_gapless=no)
+
+	if test "x$enable_gapless" = "xyes"; then
+		AC_DEFINE(ENABLE_GAPLESS, 1,
+			[Define if playbin2 supports gapless playback])
+	fi
+
 	AC_SUBST(GST_CFLAGS)
 	AC_SUBST(GST_LIBS)
 
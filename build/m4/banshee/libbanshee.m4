@@ -7,13 +7,25 @@ AC_DEFUN([BANSHEE_CHECK_LIBBANSHEE],
 
 	AM_PATH_GLIB_2_0
 
+	dnl Per thread CPU accounting for the player's streaming stages
+	AC_SEARCH_LIBS(clock_gettime, rt,
+		AC_DEFINE(HAVE_CLOCK_GETTIME, 1, [Define if clock_gettime is available]))
+
 	LIBBANSHEE_LIBS=""
 	LIBBANSHEE_CFLAGS=""
 
+	AC_ARG_ENABLE(headless,
+		AC_HELP_STRING([--enable-headless],
+			[Build libbanshee without GDK/X11 (audio playback, transcoding, ripping and analysis only)]),
+		, enable_headless="no")
+
 	GRAPHICS_SUBSYSTEM="Unknown"
 	GTK_TARGET=$(pkg-config --variable=target gtk+-2.0)
 
-	if test x$GTK_TARGET = xx11; then
+	if test "x$enable_headless" = "xyes"; then
+		AC_DEFINE(ENABLE_HEADLESS, 1, [Define if libbanshee is built without GDK])
+		GRAPHICS_SUBSYSTEM="None (headless)"
+	elif test x$GTK_TARGET = xx11; then
 		PKG_CHECK_MODULES(GDK_X11, gdk-x11-2.0 >= 2.8)
 		SHAMROCK_CONCAT_MODULE(LIBBANSHEE, GDK_X11)
 		GRAPHICS_SUBSYSTEM="X11"
@@ -25,9 +37,13 @@ AC_DEFUN([BANSHEE_CHECK_LIBBANSHEE],
 		PKG_CHECK_MODULES(GTK, gtk+-2.0 >= 2.8)
 	fi
 
-	PKG_CHECK_MODULES(CLUTTER,
-		clutter-1.0 >= 1.0.1,
-		enable_clutter=yes, enable_clutter=no)
+	if test "x$enable_headless" = "xyes"; then
+		enable_clutter=no
+	else
+		PKG_CHECK_MODULES(CLUTTER,
+			clutter-1.0 >= 1.0.1,
+			enable_clutter=yes, enable_clutter=no)
+	fi
 
 	if test "x$enable_clutter" = "xyes"; then
 		SHAMROCK_CONCAT_MODULE(LIBBANSHEE, CLUTTER)
@@ -196,6 +196,8 @@ bbd_pipeline_construct (BansheeBpmDetector *detector)
     if (detector->pipeline != NULL) {
         return TRUE;
     }
+    
+    banshee_wait_initialized ();
         
     detector->pipeline = gst_pipeline_new ("pipeline");
     if (detector->pipeline == NULL) {
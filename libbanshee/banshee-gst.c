@@ -36,6 +36,7 @@
 #include <stdarg.h>
 
 #include <gst/gst.h>
+#include <gst/controller/gstcontroller.h>
 
 #include "banshee-gst.h"
 
@@ -43,28 +44,116 @@
 #  include <gst/pbutils/pbutils.h>
 #endif
 
-static gboolean gstreamer_initialized = FALSE;
+static volatile gint gstreamer_initialized = FALSE;
+static gboolean gstreamer_initializing = FALSE;
+static GStaticMutex gstreamer_init_mutex = G_STATIC_MUTEX_INIT;
+static GCond *gstreamer_init_cond = NULL;
+static guint64 gstreamer_init_times[BANSHEE_INIT_PHASE_COUNT];
 static gboolean banshee_debugging;
 static BansheeLogHandler banshee_log_handler = NULL;
 static gint banshee_version = -1;
 
-MYEXPORT void
-gstreamer_initialize (gboolean debugging, BansheeLogHandler log_handler)
+static gboolean
+gstreamer_begin_initialize (gboolean debugging, BansheeLogHandler log_handler)
 {
-    if (gstreamer_initialized) {
-        return;
+    gboolean begin;
+    
+    // gst_init would do this anyway; we need it before the first
+    // g_cond_new, on either path, for waiters to have something to wait on
+    if (!g_thread_supported ()) {
+        g_thread_init (NULL);
+    }
+    
+    g_static_mutex_lock (&gstreamer_init_mutex);
+    
+    if (gstreamer_init_cond == NULL) {
+        gstreamer_init_cond = g_cond_new ();
     }
     
-    banshee_debugging = debugging;
-    banshee_log_handler = log_handler;
+    begin = !gstreamer_initialized && !gstreamer_initializing;
+    if (begin) {
+        banshee_debugging = debugging;
+        banshee_log_handler = log_handler;
+        gstreamer_initializing = TRUE;
+    }
+    
+    g_static_mutex_unlock (&gstreamer_init_mutex);
+    
+    return begin;
+}
 
+static gpointer
+gstreamer_do_initialize (gpointer data)
+{
+    GTimer *timer = g_timer_new ();
+    
+    // gst_init is where the registry is loaded, and rebuilt by scanning
+    // every plugin when it is missing or stale, i.e. the bulk of a cold start
     gst_init (NULL, NULL);
+    banshee_record_init_time (BANSHEE_INIT_PHASE_GST, timer);
+    
+    g_timer_start (timer);
+    gst_controller_init (NULL, NULL);
+    banshee_record_init_time (BANSHEE_INIT_PHASE_CONTROLLER, timer);
     
     #ifdef HAVE_GST_PBUTILS
+    g_timer_start (timer);
     gst_pb_utils_init ();
+    banshee_record_init_time (BANSHEE_INIT_PHASE_PBUTILS, timer);
     #endif
     
-    gstreamer_initialized = TRUE;
+    g_timer_destroy (timer);
+    
+    banshee_log_debug ("gst", "GStreamer initialized in %" G_GUINT64_FORMAT " us (registry and gst_init: %"
+        G_GUINT64_FORMAT " us)", gstreamer_init_times[BANSHEE_INIT_PHASE_GST] + 
+        gstreamer_init_times[BANSHEE_INIT_PHASE_CONTROLLER] + gstreamer_init_times[BANSHEE_INIT_PHASE_PBUTILS],
+        gstreamer_init_times[BANSHEE_INIT_PHASE_GST]);
+    
+    g_static_mutex_lock (&gstreamer_init_mutex);
+    g_atomic_int_set (&gstreamer_initialized, TRUE);
+    gstreamer_initializing = FALSE;
+    g_cond_broadcast (gstreamer_init_cond);
+    g_static_mutex_unlock (&gstreamer_init_mutex);
+    
+    return NULL;
+}
+
+MYEXPORT void
+gstreamer_initialize (gboolean debugging, BansheeLogHandler log_handler)
+{
+    if (gstreamer_begin_initialize (debugging, log_handler)) {
+        gstreamer_do_initialize (NULL);
+    } else {
+        banshee_wait_initialized ();
+    }
+}
+
+MYEXPORT void
+gstreamer_initialize_async (gboolean debugging, BansheeLogHandler log_handler)
+{
+    // Loads the registry on a thread of its own so the UI can come up
+    // while plugins are being scanned; everything that needs GStreamer
+    // waits on banshee_wait_initialized first
+    if (!gstreamer_begin_initialize (debugging, log_handler)) {
+        return;
+    }
+    
+    if (g_thread_create (gstreamer_do_initialize, NULL, FALSE, NULL) == NULL) {
+        gstreamer_do_initialize (NULL);
+    }
+}
+
+MYEXPORT gboolean
+gstreamer_is_initialized ()
+{
+    return g_atomic_int_get (&gstreamer_initialized);
+}
+
+MYEXPORT guint64
+gstreamer_get_init_time (BansheeInitPhase phase)
+{
+    g_return_val_if_fail (phase < BANSHEE_INIT_PHASE_COUNT, 0);
+    return gstreamer_init_times[phase];
 }
 
 MYEXPORT gboolean 
@@ -73,6 +162,8 @@ gstreamer_test_pipeline (gchar *pipeline)
     GstElement *element = NULL;
     GError *error = NULL;
     
+    banshee_wait_initialized ();
+    
     element = gst_parse_launch (pipeline, &error);
 
     if (element != NULL) {
@@ -82,6 +173,27 @@ gstreamer_test_pipeline (gchar *pipeline)
     return error == NULL;
 }
 
+void
+banshee_wait_initialized ()
+{
+    if (g_atomic_int_get (&gstreamer_initialized)) {
+        return;
+    }
+    
+    g_static_mutex_lock (&gstreamer_init_mutex);
+    while (gstreamer_initializing) {
+        g_cond_wait (gstreamer_init_cond, g_static_mutex_get_mutex (&gstreamer_init_mutex));
+    }
+    g_static_mutex_unlock (&gstreamer_init_mutex);
+}
+
+void
+banshee_record_init_time (BansheeInitPhase phase, GTimer *timer)
+{
+    g_return_if_fail (phase < BANSHEE_INIT_PHASE_COUNT);
+    gstreamer_init_times[phase] = (guint64)(g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC);
+}
+
 gboolean
 banshee_is_debugging ()
 {
@@ -60,12 +60,30 @@ typedef enum {
     BANSHEE_LOG_TYPE_ERROR
 } BansheeLogType;
 
+typedef enum {
+    BANSHEE_INIT_PHASE_GST,
+    BANSHEE_INIT_PHASE_CONTROLLER,
+    BANSHEE_INIT_PHASE_PBUTILS,
+    BANSHEE_INIT_PHASE_AUDIO_SINK,
+    BANSHEE_INIT_PHASE_PIPELINE,
+    BANSHEE_INIT_PHASE_COUNT
+} BansheeInitPhase;
+
 typedef void (* BansheeLogHandler) (BansheeLogType type, const gchar *component, const gchar *message);
 
 MYEXPORT void
 gstreamer_initialize (gboolean debugging, BansheeLogHandler log_handler);
+MYEXPORT void
+gstreamer_initialize_async (gboolean debugging, BansheeLogHandler log_handler);
+MYEXPORT gboolean
+gstreamer_is_initialized ();
+MYEXPORT guint64
+gstreamer_get_init_time (BansheeInitPhase phase);
+
 gboolean  banshee_is_debugging ();
 guint     banshee_get_version_number ();
+void      banshee_wait_initialized ();
+void      banshee_record_init_time (BansheeInitPhase phase, GTimer *timer);
 
 void      banshee_log_debug (const gchar *component, const gchar *format, ...);
 
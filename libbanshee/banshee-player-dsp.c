@@ -0,0 +1,590 @@
+//
+// banshee-player-dsp.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <math.h>
+#include <string.h>
+
+#include "banshee-player-dsp.h"
+
+// The SSE2 kernels are built for SSE2 whatever the rest of the build
+// targets (GCC 4.9 and clang allow the intrinsics in functions with a
+// target attribute), so i386 builds use them on every CPU that has it
+#if (defined(__i386__) || defined(__x86_64__)) && (defined(__SSE2__) || defined(__clang__) || \
+    (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#  include <emmintrin.h>
+#  include <cpuid.h>
+#  define BP_DSP_TARGET_SSE2 __attribute__((target ("sse2")))
+#  define BP_DSP_HAVE_SSE2
+#elif defined(_M_IX86) || defined(_M_X64)
+#  include <emmintrin.h>
+#  include <intrin.h>
+#  define BP_DSP_TARGET_SSE2
+#  define BP_DSP_HAVE_SSE2
+#endif
+
+// NEON is part of every AArch64 CPU. 32 bit ARM builds only get the
+// NEON kernels when built with NEON enabled, and still ask the kernel
+// whether the CPU has it before using them.
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#  include <arm_neon.h>
+#  if defined(__linux__) && !defined(__aarch64__)
+#    include <sys/auxv.h>
+#    include <asm/hwcap.h>
+#  endif
+#  define BP_DSP_HAVE_NEON
+#endif
+
+// The vis kernels: splitting interleaved PCM into planar channels plus a
+// mono downmix, applying a precomputed window, and turning FFT bins into
+// the 0..1 dB scale the host draws (-60 dB and below is 0). The SIMD
+// versions are picked once at runtime, from what the CPU reports; all of
+// them share the scalar fallback for whatever is left over past the last
+// full vector.
+//
+// The dB step uses a polynomial log2 on the float's mantissa (off by at
+// most 2e-4, or 0.001 dB) instead of log10f on every bin. There are no
+// AVX kernels: a slice is a few hundred to a few thousand bins, which
+// the wider registers barely speed up once the AVX/SSE transition
+// penalties and the lower clocks of the CPUs that have it are paid.
+
+typedef struct {
+    const gchar *name;
+    void (* deinterleave) (const gfloat *in, gfloat *planar, gfloat *mono, gint channels, gint samples);
+    void (* window)       (gfloat *data, const gfloat *table, gint length);
+    void (* power_db)     (const GstFFTF32Complex *bins, gfloat *out, gint count, gfloat log2_scale);
+} BpDspKernels;
+
+// Low pass for each halving stage of _bp_dsp_decimate: a 31 tap Kaiser
+// windowed sinc (beta 6), cut off at half the new Nyquist frequency. In
+// a half-band filter every other tap is zero, so only the centre and the
+// odd taps on one side are kept. Whatever folds back below 0.72 of the
+// new Nyquist frequency is more than 61 dB down, i.e. under the bottom of
+// the vis dB scale; only the top of the band can show some aliasing.
+#define BP_DSP_HALFBAND_CENTER (0.4999739547f)
+
+static const gfloat bp_dsp_halfband[] = {
+    3.144409659e-01f, -9.499996138e-02f, 4.659148217e-02f, -2.425235032e-02f,
+    1.198968642e-02f, -5.209005770e-03f, 1.767811206e-03f, -3.156055751e-04f
+};
+
+// 10 * log10 (x) = 10 * log10 (2) * log2 (x), then (dB + 60) / 60
+#define BP_DSP_DB_PER_LOG2 (10.0f * 0.30102999566f / 60.0f)
+
+// Least squares fit of log2 (m) for m in [1, 2)
+#define BP_DSP_LOG2_C0 (-2.49680584f)
+#define BP_DSP_LOG2_C1 (4.02845046f)
+#define BP_DSP_LOG2_C2 (-2.08112845f)
+#define BP_DSP_LOG2_C3 (0.628841375f)
+#define BP_DSP_LOG2_C4 (-0.0791538161f)
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static inline gfloat
+bp_dsp_log2 (gfloat value)
+{
+    union { gfloat f; guint32 i; } bits;
+    gfloat exponent, m;
+    
+    bits.f = value;
+    exponent = (gfloat)(gint)(((bits.i >> 23) & 0xff) - 127);
+    bits.i = (bits.i & 0x7fffff) | 0x3f800000;
+    m = bits.f;
+    
+    return exponent + BP_DSP_LOG2_C0 + (BP_DSP_LOG2_C1 + (BP_DSP_LOG2_C2 + 
+        (BP_DSP_LOG2_C3 + BP_DSP_LOG2_C4 * m) * m) * m) * m;
+}
+
+static inline gfloat
+bp_dsp_db_scale (gfloat power, gfloat log2_scale)
+{
+    gfloat value = (bp_dsp_log2 (power) + log2_scale) * BP_DSP_DB_PER_LOG2 + 1.0f;
+    return power > 0.0f && value > 0.0f ? value : 0.0f;
+}
+
+static void
+bp_dsp_deinterleave_c (const gfloat *in, gfloat *planar, gfloat *mono, gint channels, gint samples)
+{
+    gint i, j;
+    gfloat scale = 1.0f / channels;
+    
+    for (i = 0; i < samples; i++) {
+        gfloat sum = 0.0f;
+        
+        for (j = 0; j < channels; j++) {
+            gfloat sample = in[i * channels + j];
+            planar[j * samples + i] = sample;
+            sum += sample;
+        }
+        
+        mono[i] = sum * scale;
+    }
+}
+
+static void
+bp_dsp_window_c (gfloat *data, const gfloat *table, gint length)
+{
+    gint i;
+    
+    for (i = 0; i < length; i++) {
+        data[i] *= table[i];
+    }
+}
+
+static void
+bp_dsp_power_db_c (const GstFFTF32Complex *bins, gfloat *out, gint count, gfloat log2_scale)
+{
+    gint i;
+    
+    for (i = 0; i < count; i++) {
+        out[i] = bp_dsp_db_scale (bins[i].r * bins[i].r + bins[i].i * bins[i].i, log2_scale);
+    }
+}
+
+static const BpDspKernels bp_dsp_kernels_c = {
+    "scalar",
+    bp_dsp_deinterleave_c,
+    bp_dsp_window_c,
+    bp_dsp_power_db_c
+};
+
+#ifdef BP_DSP_HAVE_SSE2
+
+BP_DSP_TARGET_SSE2 static inline __m128
+bp_dsp_db_scale_sse2 (__m128 power, __m128 log2_scale)
+{
+    __m128i bits = _mm_castps_si128 (power);
+    __m128 exponent, m, value;
+    
+    exponent = _mm_cvtepi32_ps (_mm_sub_epi32 (_mm_and_si128 (_mm_srli_epi32 (bits, 23), 
+        _mm_set1_epi32 (0xff)), _mm_set1_epi32 (127)));
+    m = _mm_castsi128_ps (_mm_or_si128 (_mm_and_si128 (bits, _mm_set1_epi32 (0x7fffff)), 
+        _mm_set1_epi32 (0x3f800000)));
+    
+    value = _mm_add_ps (_mm_set1_ps (BP_DSP_LOG2_C3), _mm_mul_ps (_mm_set1_ps (BP_DSP_LOG2_C4), m));
+    value = _mm_add_ps (_mm_set1_ps (BP_DSP_LOG2_C2), _mm_mul_ps (value, m));
+    value = _mm_add_ps (_mm_set1_ps (BP_DSP_LOG2_C1), _mm_mul_ps (value, m));
+    value = _mm_add_ps (_mm_set1_ps (BP_DSP_LOG2_C0), _mm_mul_ps (value, m));
+    value = _mm_add_ps (_mm_add_ps (value, exponent), log2_scale);
+    value = _mm_add_ps (_mm_mul_ps (value, _mm_set1_ps (BP_DSP_DB_PER_LOG2)), _mm_set1_ps (1.0f));
+    
+    // Clamps negatives and, with power == 0 giving a huge negative log, silence
+    value = _mm_and_ps (value, _mm_cmpgt_ps (power, _mm_setzero_ps ()));
+    return _mm_max_ps (value, _mm_setzero_ps ());
+}
+
+BP_DSP_TARGET_SSE2 static void
+bp_dsp_deinterleave_sse2 (const gfloat *in, gfloat *planar, gfloat *mono, gint channels, gint samples)
+{
+    gfloat *left = planar, *right = planar + samples;
+    __m128 half = _mm_set1_ps (0.5f);
+    gint i;
+    
+    if (channels != 2) {
+        bp_dsp_deinterleave_c (in, planar, mono, channels, samples);
+        return;
+    }
+    
+    for (i = 0; i + 4 <= samples; i += 4) {
+        __m128 a = _mm_loadu_ps (in + i * 2);
+        __m128 b = _mm_loadu_ps (in + i * 2 + 4);
+        __m128 l = _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0));
+        __m128 r = _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1));
+        
+        _mm_storeu_ps (left + i, l);
+        _mm_storeu_ps (right + i, r);
+        _mm_storeu_ps (mono + i, _mm_mul_ps (_mm_add_ps (l, r), half));
+    }
+    
+    for (; i < samples; i++) {
+        left[i] = in[i * 2];
+        right[i] = in[i * 2 + 1];
+        mono[i] = (left[i] + right[i]) * 0.5f;
+    }
+}
+
+BP_DSP_TARGET_SSE2 static void
+bp_dsp_window_sse2 (gfloat *data, const gfloat *table, gint length)
+{
+    gint i;
+    
+    for (i = 0; i + 4 <= length; i += 4) {
+        _mm_storeu_ps (data + i, _mm_mul_ps (_mm_loadu_ps (data + i), _mm_loadu_ps (table + i)));
+    }
+    
+    bp_dsp_window_c (data + i, table + i, length - i);
+}
+
+BP_DSP_TARGET_SSE2 static void
+bp_dsp_power_db_sse2 (const GstFFTF32Complex *bins, gfloat *out, gint count, gfloat log2_scale)
+{
+    const gfloat *in = (const gfloat *)bins;
+    __m128 scale = _mm_set1_ps (log2_scale);
+    gint i;
+    
+    for (i = 0; i + 4 <= count; i += 4) {
+        __m128 a = _mm_loadu_ps (in + i * 2);
+        __m128 b = _mm_loadu_ps (in + i * 2 + 4);
+        __m128 re = _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1));
+        __m128 power = _mm_add_ps (_mm_mul_ps (re, re), _mm_mul_ps (im, im));
+        
+        _mm_storeu_ps (out + i, bp_dsp_db_scale_sse2 (power, scale));
+    }
+    
+    bp_dsp_power_db_c (bins + i, out + i, count - i, log2_scale);
+}
+
+static const BpDspKernels bp_dsp_kernels_sse2 = {
+    "SSE2",
+    bp_dsp_deinterleave_sse2,
+    bp_dsp_window_sse2,
+    bp_dsp_power_db_sse2
+};
+
+static gboolean
+bp_dsp_have_sse2 ()
+{
+    #ifdef _MSC_VER
+    int info[4];
+    
+    __cpuid (info, 1);
+    return (info[3] & (1 << 26)) != 0;
+    #else
+    guint eax, ebx, ecx, edx;
+    
+    if (!__get_cpuid (1, &eax, &ebx, &ecx, &edx)) {
+        return FALSE;
+    }
+    
+    return (edx & bit_SSE2) != 0;
+    #endif
+}
+
+#endif /* BP_DSP_HAVE_SSE2 */
+
+#ifdef BP_DSP_HAVE_NEON
+
+static inline float32x4_t
+bp_dsp_db_scale_neon (float32x4_t power, float32x4_t log2_scale)
+{
+    uint32x4_t bits = vreinterpretq_u32_f32 (power);
+    float32x4_t exponent, m, value;
+    
+    exponent = vcvtq_f32_s32 (vsubq_s32 (vreinterpretq_s32_u32 (vandq_u32 (vshrq_n_u32 (bits, 23), 
+        vdupq_n_u32 (0xff))), vdupq_n_s32 (127)));
+    m = vreinterpretq_f32_u32 (vorrq_u32 (vandq_u32 (bits, vdupq_n_u32 (0x7fffff)), 
+        vdupq_n_u32 (0x3f800000)));
+    
+    value = vmlaq_f32 (vdupq_n_f32 (BP_DSP_LOG2_C3), vdupq_n_f32 (BP_DSP_LOG2_C4), m);
+    value = vmlaq_f32 (vdupq_n_f32 (BP_DSP_LOG2_C2), value, m);
+    value = vmlaq_f32 (vdupq_n_f32 (BP_DSP_LOG2_C1), value, m);
+    value = vmlaq_f32 (vdupq_n_f32 (BP_DSP_LOG2_C0), value, m);
+    value = vaddq_f32 (vaddq_f32 (value, exponent), log2_scale);
+    value = vmlaq_f32 (vdupq_n_f32 (1.0f), value, vdupq_n_f32 (BP_DSP_DB_PER_LOG2));
+    
+    value = vreinterpretq_f32_u32 (vandq_u32 (vreinterpretq_u32_f32 (value), 
+        vcgtq_f32 (power, vdupq_n_f32 (0.0f))));
+    return vmaxq_f32 (value, vdupq_n_f32 (0.0f));
+}
+
+static void
+bp_dsp_deinterleave_neon (const gfloat *in, gfloat *planar, gfloat *mono, gint channels, gint samples)
+{
+    gfloat *left = planar, *right = planar + samples;
+    gint i;
+    
+    if (channels != 2) {
+        bp_dsp_deinterleave_c (in, planar, mono, channels, samples);
+        return;
+    }
+    
+    for (i = 0; i + 4 <= samples; i += 4) {
+        float32x4x2_t lr = vld2q_f32 (in + i * 2);
+        
+        vst1q_f32 (left + i, lr.val[0]);
+        vst1q_f32 (right + i, lr.val[1]);
+        vst1q_f32 (mono + i, vmulq_n_f32 (vaddq_f32 (lr.val[0], lr.val[1]), 0.5f));
+    }
+    
+    for (; i < samples; i++) {
+        left[i] = in[i * 2];
+        right[i] = in[i * 2 + 1];
+        mono[i] = (left[i] + right[i]) * 0.5f;
+    }
+}
+
+static void
+bp_dsp_window_neon (gfloat *data, const gfloat *table, gint length)
+{
+    gint i;
+    
+    for (i = 0; i + 4 <= length; i += 4) {
+        vst1q_f32 (data + i, vmulq_f32 (vld1q_f32 (data + i), vld1q_f32 (table + i)));
+    }
+    
+    bp_dsp_window_c (data + i, table + i, length - i);
+}
+
+static void
+bp_dsp_power_db_neon (const GstFFTF32Complex *bins, gfloat *out, gint count, gfloat log2_scale)
+{
+    const gfloat *in = (const gfloat *)bins;
+    float32x4_t scale = vdupq_n_f32 (log2_scale);
+    gint i;
+    
+    for (i = 0; i + 4 <= count; i += 4) {
+        float32x4x2_t ri = vld2q_f32 (in + i * 2);
+        float32x4_t power = vmlaq_f32 (vmulq_f32 (ri.val[0], ri.val[0]), ri.val[1], ri.val[1]);
+        
+        vst1q_f32 (out + i, bp_dsp_db_scale_neon (power, scale));
+    }
+    
+    bp_dsp_power_db_c (bins + i, out + i, count - i, log2_scale);
+}
+
+static const BpDspKernels bp_dsp_kernels_neon = {
+    "NEON",
+    bp_dsp_deinterleave_neon,
+    bp_dsp_window_neon,
+    bp_dsp_power_db_neon
+};
+
+static gboolean
+bp_dsp_have_neon ()
+{
+    #if defined(__aarch64__)
+    return TRUE;
+    #elif defined(__linux__) && defined(AT_HWCAP) && defined(HWCAP_NEON)
+    return (getauxval (AT_HWCAP) & HWCAP_NEON) != 0;
+    #else
+    // Nothing to ask; the build was told the CPU has it
+    return TRUE;
+    #endif
+}
+
+#endif /* BP_DSP_HAVE_NEON */
+
+static gpointer
+bp_dsp_select_kernels (gpointer data)
+{
+    const BpDspKernels *kernels = &bp_dsp_kernels_c;
+    
+    // Lets the SIMD kernels be compared against the scalar ones
+    if (g_getenv ("BANSHEE_DSP_SCALAR") == NULL) {
+        #ifdef BP_DSP_HAVE_SSE2
+        if (bp_dsp_have_sse2 ()) {
+            kernels = &bp_dsp_kernels_sse2;
+        }
+        #endif
+        
+        #ifdef BP_DSP_HAVE_NEON
+        if (bp_dsp_have_neon ()) {
+            kernels = &bp_dsp_kernels_neon;
+        }
+        #endif
+    }
+    
+    bp_debug ("Using %s visualization kernels", kernels->name);
+    return (gpointer)kernels;
+}
+
+static inline const BpDspKernels *
+bp_dsp_kernels ()
+{
+    static GOnce once = G_ONCE_INIT;
+    return (const BpDspKernels *)g_once (&once, bp_dsp_select_kernels, NULL);
+}
+
+static gdouble
+bp_dsp_hz_to_bark (gdouble hz)
+{
+    // Traunmueller's approximation
+    return 26.81 * hz / (1960.0 + hz) - 0.53;
+}
+
+static gdouble
+bp_dsp_bark_to_hz (gdouble bark)
+{
+    return 1960.0 * (bark + 0.53) / (26.28 - bark);
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+gfloat *
+_bp_dsp_hamming_new (gint length)
+{
+    gfloat *table = g_new (gfloat, length);
+    gint i;
+    
+    // Same window gst_fft_f32_window applies, computed once instead
+    // of on every slice
+    for (i = 0; i < length; i++) {
+        table[i] = 0.53836 - 0.46164 * cos (2.0 * G_PI * i / length);
+    }
+    
+    return table;
+}
+
+gint
+_bp_dsp_fft_length (gint length)
+{
+    // gst_fft_f32 runs a complex FFT of half the (even) length, which
+    // kiss_fft does quickest when that half factors into 2, 3 and 5.
+    // This changes the bin count, so it is only applied on request.
+    return 2 * gst_fft_next_fast_length ((length + 1) / 2);
+}
+
+gint *
+_bp_dsp_band_edges_new (BpVisBandScale scale, gint bands, gint bins, gint rate)
+{
+    gint *edges = g_new (gint, bands + 1);
+    gdouble low, high, position;
+    gint i;
+    
+    // Log and Bark bands start at 20 Hz, or the first bin above DC
+    low = MAX (20.0, (gdouble)rate / (bins * 2));
+    high = rate / 2.0;
+    
+    for (i = 0; i <= bands; i++) {
+        position = (gdouble)i / bands;
+        
+        switch (scale) {
+            case BP_VIS_BAND_SCALE_LOG:
+                edges[i] = (gint)(low * pow (high / low, position) * bins / high);
+                break;
+            case BP_VIS_BAND_SCALE_BARK:
+                edges[i] = (gint)(bp_dsp_bark_to_hz (bp_dsp_hz_to_bark (low) + position * 
+                    (bp_dsp_hz_to_bark (high) - bp_dsp_hz_to_bark (low))) * bins / high);
+                break;
+            default:
+                edges[i] = (gint)(position * bins);
+                break;
+        }
+    }
+    
+    // The low bands are narrower than a bin; give each band at least
+    // one bin of its own and push the rest up, without running off the end
+    for (i = 1; i <= bands; i++) {
+        edges[i] = MAX (edges[i], edges[i - 1] + 1);
+    }
+    
+    edges[bands] = bins;
+    for (i = bands - 1; i >= 0; i--) {
+        edges[i] = MIN (edges[i], edges[i + 1] - 1);
+    }
+    
+    return edges;
+}
+
+gint
+_bp_dsp_decimate_history_length (gint rows, gint factor)
+{
+    // One stage per halving
+    return rows * (g_bit_storage (factor) - 1) * BP_DSP_DECIMATE_HISTORY;
+}
+
+void
+_bp_dsp_decimate (gfloat *data, gfloat *history, gfloat *scratch, 
+    gint rows, gint samples, gint factor)
+{
+    gint out_samples = samples / factor;
+    gint row, stage, length, i, j;
+    
+    // factor is a power of two, taken in halving stages with the half-band
+    // filter above. history carries the filter's input over from the last
+    // call, see _bp_dsp_decimate_history_length; scratch holds samples plus
+    // BP_DSP_DECIMATE_HISTORY. Works in place: rows of samples become rows
+    // of samples / factor, packed to the front.
+    for (row = 0; row < rows; row++) {
+        gfloat *in = data + row * samples;
+        
+        for (stage = 1, length = samples; stage < factor; stage *= 2, length /= 2) {
+            memcpy (scratch, history, BP_DSP_DECIMATE_HISTORY * sizeof (gfloat));
+            memcpy (scratch + BP_DSP_DECIMATE_HISTORY, in, length * sizeof (gfloat));
+            memcpy (history, scratch + length, BP_DSP_DECIMATE_HISTORY * sizeof (gfloat));
+            history += BP_DSP_DECIMATE_HISTORY;
+            
+            // Each output sample is centred on an even input sample,
+            // BP_DSP_DECIMATE_HISTORY / 2 behind the newest one it uses
+            for (i = 0; i < length / 2; i++) {
+                const gfloat *x = scratch + 2 * i + BP_DSP_DECIMATE_HISTORY / 2;
+                gfloat sum = BP_DSP_HALFBAND_CENTER * x[0];
+                
+                for (j = 0; j < (gint)G_N_ELEMENTS (bp_dsp_halfband); j++) {
+                    sum += bp_dsp_halfband[j] * (x[-(2 * j + 1)] + x[2 * j + 1]);
+                }
+                
+                in[i] = sum;
+            }
+        }
+        
+        memmove (data + row * out_samples, in, out_samples * sizeof (gfloat));
+    }
+}
+
+void
+_bp_dsp_reduce_bands (const gfloat *bins, const gint *edges, gfloat *out, gint bands)
+{
+    gint i, j;
+    
+    // Bars show the loudest bin under them, which keeps narrow peaks in
+    // the wide upper bands from being averaged away
+    for (i = 0; i < bands; i++) {
+        gfloat peak = 0.0f;
+        
+        for (j = edges[i]; j < edges[i + 1]; j++) {
+            peak = MAX (peak, bins[j]);
+        }
+        
+        out[i] = peak;
+    }
+}
+
+void
+_bp_dsp_deinterleave (const gfloat *in, gfloat *planar, gfloat *mono, gint channels, gint samples)
+{
+    bp_dsp_kernels ()->deinterleave (in, planar, mono, channels, samples);
+}
+
+void
+_bp_dsp_window (gfloat *data, const gfloat *table, gint length)
+{
+    bp_dsp_kernels ()->window (data, table, length);
+}
+
+void
+_bp_dsp_power_db (const GstFFTF32Complex *bins, gfloat *out, gint count, gfloat scale)
+{
+    // The power scale goes in as a log2 offset, so it costs one add per bin
+    bp_dsp_kernels ()->power_db (bins, out, count, (gfloat)(log (scale) / G_LN2));
+}
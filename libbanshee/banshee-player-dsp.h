@@ -0,0 +1,49 @@
+//
+// banshee-player-dsp.h
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _BANSHEE_PLAYER_DSP_H
+#define _BANSHEE_PLAYER_DSP_H
+
+#include "banshee-player-private.h"
+
+// Samples of history _bp_dsp_decimate keeps for each row and halving stage
+#define BP_DSP_DECIMATE_HISTORY 30
+
+gfloat  *_bp_dsp_hamming_new    (gint length);
+gint     _bp_dsp_fft_length     (gint length);
+void     _bp_dsp_deinterleave   (const gfloat *in, gfloat *planar, gfloat *mono, gint channels, gint samples);
+void     _bp_dsp_window         (gfloat *data, const gfloat *table, gint length);
+void     _bp_dsp_power_db       (const GstFFTF32Complex *bins, gfloat *out, gint count, gfloat scale);
+gint    *_bp_dsp_band_edges_new (BpVisBandScale scale, gint bands, gint bins, gint rate);
+gint     _bp_dsp_decimate_history_length (gint rows, gint factor);
+void     _bp_dsp_decimate       (gfloat *data, gfloat *history, gfloat *scratch, 
+                                 gint rows, gint samples, gint factor);
+void     _bp_dsp_reduce_bands   (const gfloat *bins, const gint *edges, gfloat *out, gint bands);
+
+#endif /* _BANSHEE_PLAYER_DSP_H */
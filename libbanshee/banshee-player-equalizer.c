@@ -28,7 +28,7 @@
 // WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
-#include "banshee-player-private.h"
+#include "banshee-player-equalizer.h"
 
 enum _BpEqStatus {
     BP_EQ_STATUS_UNCHECKED,
@@ -37,10 +37,302 @@ enum _BpEqStatus {
     BP_EQ_STATUS_USE_SYSTEM
 };
 
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static gboolean
+bp_equalizer_is_flat (BansheePlayer *player)
+{
+    gdouble level, gain;
+    guint i, count;
+    
+    g_object_get (player->preamp, "volume", &level, NULL);
+    if (level != 1.0) {
+        return FALSE;
+    }
+    
+    count = gst_child_proxy_get_children_count (GST_CHILD_PROXY (player->equalizer));
+    
+    for (i = 0; i < count; i++) {
+        GstObject *band;
+        
+        band = gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (player->equalizer), i);
+        g_object_get (band, "gain", &gain, NULL);
+        g_object_unref (band);
+        
+        if (gain != 0.0) {
+            return FALSE;
+        }
+    }
+    
+    return TRUE;
+}
+
+static GstElement *
+bp_equalizer_element_new (const gchar *factory, const gchar *name)
+{
+    GstElement *element;
+    
+    if ((element = gst_element_factory_make (factory, name)) != NULL) {
+        gst_object_ref (element);
+        gst_object_sink (element);
+    }
+    
+    return element;
+}
+
+static void
+bp_equalizer_free (BansheePlayer *player)
+{
+    GstElement **elements[4];
+    gint i;
+    
+    elements[0] = &player->equalizer;
+    elements[1] = &player->preamp;
+    elements[2] = &player->equalizer_audioconvert;
+    elements[3] = &player->equalizer_audioconvert2;
+    
+    for (i = 0; i < (gint)G_N_ELEMENTS (elements); i++) {
+        if (*elements[i] != NULL) {
+            gst_object_unref (*elements[i]);
+            *elements[i] = NULL;
+        }
+    }
+}
+
+static gboolean
+bp_equalizer_create (BansheePlayer *player)
+{
+    // The EQ chain (two converters, the preamp and the equalizer) is only
+    // built the first time it would change the sound, and kept around,
+    // in or out of the pipeline, from then on
+    if (player->equalizer != NULL) {
+        return TRUE;
+    }
+    
+    if (player->audiobin == NULL || player->equalizer_upstream == NULL) {
+        return FALSE;
+    }
+    
+    if ((player->equalizer = _bp_equalizer_new (player)) == NULL) {
+        return FALSE;
+    }
+    
+    gst_object_ref (player->equalizer);
+    gst_object_sink (player->equalizer);
+    
+    player->preamp = bp_equalizer_element_new ("volume", "preamp");
+    player->equalizer_audioconvert = bp_equalizer_element_new ("audioconvert", "audioconvert");
+    player->equalizer_audioconvert2 = bp_equalizer_element_new ("audioconvert", "audioconvert2");
+    
+    if (player->preamp == NULL || player->equalizer_audioconvert == NULL || 
+        player->equalizer_audioconvert2 == NULL) {
+        bp_debug ("Could not create the equalizer chain, leaving EQ out");
+        bp_equalizer_free (player);
+        return FALSE;
+    }
+    
+    return TRUE;
+}
+
+static void
+bp_equalizer_replay_segment (BansheePlayer *player, GstElement *element)
+{
+    GstSegment *segment = player->segment;
+    GstPad *pad;
+    
+    if (segment == NULL) {
+        return;
+    }
+    
+    // Same as a tee branch linked mid-stream (see banshee-player-tee.c):
+    // the chain never saw the segment, so replay it, accumulated running
+    // time first. It stops at the still unlinked last converter, since
+    // the sink downstream already has it.
+    pad = gst_element_get_static_pad (element, "sink");
+    
+    if (segment->accum > 0) {
+        gst_pad_send_event (pad, gst_event_new_new_segment_full (FALSE, 1.0, 1.0, 
+            GST_FORMAT_TIME, 0, segment->accum, 0));
+    }
+    
+    gst_pad_send_event (pad, gst_event_new_new_segment_full (FALSE, segment->rate, 
+        segment->applied_rate, GST_FORMAT_TIME, segment->start, segment->stop, segment->time));
+    
+    gst_object_unref (pad);
+}
+
+static void
+bp_equalizer_link (BansheePlayer *player, gboolean replay_segment)
+{
+    GstElement *audioconvert = player->equalizer_audioconvert;
+    GstElement *audioconvert2 = player->equalizer_audioconvert2;
+    
+    gst_bin_add_many (GST_BIN (player->audiobin), audioconvert, player->preamp,
+        player->equalizer, audioconvert2, NULL);
+    gst_element_link_many (audioconvert, player->preamp, player->equalizer, audioconvert2, NULL);
+    
+    gst_element_sync_state_with_parent (audioconvert);
+    gst_element_sync_state_with_parent (player->preamp);
+    gst_element_sync_state_with_parent (player->equalizer);
+    gst_element_sync_state_with_parent (audioconvert2);
+    
+    if (replay_segment) {
+        bp_equalizer_replay_segment (player, audioconvert);
+    }
+    
+    gst_element_unlink (player->equalizer_upstream, player->equalizer_downstream);
+    gst_element_link (player->equalizer_upstream, audioconvert);
+    gst_element_link (audioconvert2, player->equalizer_downstream);
+}
+
+static void
+bp_equalizer_unlink (BansheePlayer *player)
+{
+    GstElement *chain[4];
+    gint i;
+    
+    chain[0] = player->equalizer_audioconvert;
+    chain[1] = player->preamp;
+    chain[2] = player->equalizer;
+    chain[3] = player->equalizer_audioconvert2;
+    
+    gst_element_unlink (player->equalizer_upstream, chain[0]);
+    gst_element_unlink (chain[3], player->equalizer_downstream);
+    gst_element_link (player->equalizer_upstream, player->equalizer_downstream);
+    
+    // Nothing reaches the chain any more and it has no threads of its
+    // own, so it can be taken down from here; our references keep the
+    // elements, and their settings, once the bin lets go of them
+    for (i = 0; i < (gint)G_N_ELEMENTS (chain); i++) {
+        gst_element_set_state (chain[i], GST_STATE_NULL);
+        gst_bin_remove (GST_BIN (player->audiobin), chain[i]);
+    }
+}
+
+static void
+bp_equalizer_splice (BansheePlayer *player, gboolean replay_segment)
+{
+    // Called with the mutex held
+    if (player->equalizer_wanted == player->equalizer_linked) {
+        return;
+    }
+    
+    if (player->equalizer_wanted) {
+        bp_equalizer_link (player, replay_segment);
+    } else {
+        bp_equalizer_unlink (player);
+    }
+    
+    player->equalizer_linked = player->equalizer_wanted;
+}
+
+static void
+bp_equalizer_blocked (GstPad *pad, gboolean blocked, BansheePlayer *player)
+{
+    if (!blocked) {
+        return;
+    }
+    
+    // The queue's task is parked on this pad, so the chain can be
+    // spliced in between it and the sink, or out again, without racing
+    // a buffer. Unblocking under the mutex keeps a block asked for in
+    // the meantime from being lifted along with this one.
+    g_mutex_lock (player->mutex);
+    bp_equalizer_splice (player, TRUE);
+    player->equalizer_blocking = FALSE;
+    gst_pad_set_blocked_async (pad, FALSE, (GstPadBlockCallback)bp_equalizer_blocked, player);
+    g_mutex_unlock (player->mutex);
+}
+
+static void
+bp_equalizer_update (BansheePlayer *player)
+{
+    GstState state;
+    GstPad *pad;
+    
+    g_mutex_lock (player->mutex);
+    
+    player->equalizer_wanted = !bp_equalizer_is_flat (player);
+    
+    if (player->equalizer_wanted == player->equalizer_linked || player->equalizer_blocking) {
+        // Nothing to do, or the pending block picks up the change
+        g_mutex_unlock (player->mutex);
+        return;
+    }
+    
+    gst_element_get_state (player->audiobin, &state, NULL, 0);
+    
+    if (state <= GST_STATE_READY) {
+        bp_equalizer_splice (player, FALSE);
+        g_mutex_unlock (player->mutex);
+        return;
+    }
+    
+    // Otherwise splice it at the next buffer. While PAUSED that is only
+    // once playback resumes: the queue's task sits in the sink's preroll,
+    // not on the blocked pad, so the prerolled buffer itself goes out
+    // as it was. The settings are already on the elements meanwhile.
+    pad = gst_element_get_static_pad (player->equalizer_upstream, "src");
+    player->equalizer_blocking = TRUE;
+    gst_pad_set_blocked_async (pad, TRUE, (GstPadBlockCallback)bp_equalizer_blocked, player);
+    gst_object_unref (pad);
+    
+    g_mutex_unlock (player->mutex);
+}
+
+static GstElement *
+bp_equalizer_query_element (BansheePlayer *player)
+{
+    GstElement *equalizer;
+    
+    // Band layout and ranges come from the live element if there is one,
+    // or else from a throwaway instance of the same factory
+    if (player->equalizer != NULL) {
+        return gst_object_ref (player->equalizer);
+    }
+    
+    if ((equalizer = _bp_equalizer_new (player)) != NULL) {
+        gst_object_ref (equalizer);
+        gst_object_sink (equalizer);
+    }
+    
+    return equalizer;
+}
+
 // ---------------------------------------------------------------------------
 // Internal Functions
 // ---------------------------------------------------------------------------
 
+void
+_bp_equalizer_pipeline_setup (BansheePlayer *player, GstElement *upstream, GstElement *downstream)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // Nothing is built here; the chain goes in between these two once it
+    // actually changes the sound, see bp_equalizer_create
+    player->equalizer_upstream = upstream;
+    player->equalizer_downstream = downstream;
+    player->equalizer_linked = FALSE;
+    player->equalizer_wanted = FALSE;
+    player->equalizer_blocking = FALSE;
+}
+
+void
+_bp_equalizer_pipeline_destroy (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    bp_equalizer_free (player);
+    
+    player->equalizer_upstream = NULL;
+    player->equalizer_downstream = NULL;
+    player->equalizer_linked = FALSE;
+    player->equalizer_wanted = FALSE;
+    player->equalizer_blocking = FALSE;
+}
+
 GstElement *
 _bp_equalizer_new (BansheePlayer *player)
 {
@@ -102,95 +394,134 @@ _bp_equalizer_new (BansheePlayer *player)
 P_INVOKE gboolean
 bp_equalizer_is_supported (BansheePlayer *player)
 {
-    return player != NULL && player->equalizer != NULL && player->preamp != NULL;
+    GstElement *equalizer;
+    GstElementFactory *factory;
+    gboolean supported;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    if (player->equalizer != NULL) {
+        return TRUE;
+    }
+    
+    // Nothing may have been built yet, so ask the factories
+    if ((equalizer = bp_equalizer_query_element (player)) == NULL) {
+        return FALSE;
+    }
+    
+    gst_object_unref (equalizer);
+    
+    factory = gst_element_factory_find ("volume");
+    supported = factory != NULL;
+    if (factory != NULL) {
+        gst_object_unref (factory);
+    }
+    
+    return supported;
 }
 
 P_INVOKE void
 bp_equalizer_set_preamp_level (BansheePlayer *player, gdouble level)
 {
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
-
-    if (player->equalizer != NULL && player->preamp != NULL) {
-        g_object_set (player->preamp, "volume", level, NULL);
+    
+    // Unity gain on a chain that does not exist yet changes nothing
+    if (player->equalizer == NULL && (level == 1.0 || !bp_equalizer_create (player))) {
+        return;
     }
+    
+    g_object_set (player->preamp, "volume", level, NULL);
+    bp_equalizer_update (player);
 }
 
 P_INVOKE void
 bp_equalizer_set_gain (BansheePlayer *player, guint bandnum, gdouble gain)
 {
+    GstObject *band;
+    
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
     
-    if (player->equalizer != NULL) {
-        GstObject *band;
-
-        g_return_if_fail (bandnum < gst_child_proxy_get_children_count (GST_CHILD_PROXY (player->equalizer)));
-
-        band = gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (player->equalizer), bandnum);
-        g_object_set (band, "gain", gain, NULL);
-        g_object_unref (band);
+    // Likewise for a flat band
+    if (player->equalizer == NULL && (gain == 0.0 || !bp_equalizer_create (player))) {
+        return;
     }
+    
+    g_return_if_fail (bandnum < gst_child_proxy_get_children_count (GST_CHILD_PROXY (player->equalizer)));
+    
+    band = gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (player->equalizer), bandnum);
+    g_object_set (band, "gain", gain, NULL);
+    g_object_unref (band);
+    
+    bp_equalizer_update (player);
 }
 
 P_INVOKE void
 bp_equalizer_get_bandrange (BansheePlayer *player, gint *min, gint *max)
 {    
+    GstElement *equalizer;
     GParamSpec *pspec;
     GParamSpecDouble *dpspec;
     
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
     
-    if (player->equalizer == NULL) {
+    if ((equalizer = bp_equalizer_query_element (player)) == NULL) {
         return;
     }
     
     // Fetch gain range of first band (since it should be the same for the rest)
-    pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (player->equalizer), "band0::gain");
+    pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (equalizer), "band0::gain");
     if (pspec == NULL)
-        pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (player->equalizer), "band0");
+        pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (equalizer), "band0");
 
     if (pspec != NULL && G_IS_PARAM_SPEC_DOUBLE (pspec)) {
         dpspec = (GParamSpecDouble *) pspec;
         *min = dpspec->minimum;
         *max = dpspec->maximum;
-        return;
     } else {
        g_warning ("Could not find valid gain range for equalizer element");
     }
+    
+    gst_object_unref (equalizer);
 }
 
 P_INVOKE guint
 bp_equalizer_get_nbands (BansheePlayer *player)
 {
+    GstElement *equalizer;
     guint count;
     
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
 
-    if (player->equalizer == NULL) {
+    if ((equalizer = bp_equalizer_query_element (player)) == NULL) {
         return 0;
     }
 
-    count = gst_child_proxy_get_children_count (GST_CHILD_PROXY (player->equalizer));
+    count = gst_child_proxy_get_children_count (GST_CHILD_PROXY (equalizer));
+    gst_object_unref (equalizer);
     return count;
 }
 
 P_INVOKE void
 bp_equalizer_get_frequencies (BansheePlayer *player, gdouble **freq)
 {
+    GstElement *equalizer;
     gint i, count;
     
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
 
-    if (player->equalizer == NULL) {
+    if ((equalizer = bp_equalizer_query_element (player)) == NULL) {
         return;
     }
 
-    count = gst_child_proxy_get_children_count (GST_CHILD_PROXY (player->equalizer));
+    count = gst_child_proxy_get_children_count (GST_CHILD_PROXY (equalizer));
     
     for (i = 0; i < count; i++) {
         GstObject *band;
         
-        band = gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (player->equalizer), i);
+        band = gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (equalizer), i);
         g_object_get (G_OBJECT (band), "freq", &(*freq)[i], NULL);
         g_object_unref (band);
     }
+    
+    gst_object_unref (equalizer);
 }
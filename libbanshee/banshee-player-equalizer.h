@@ -31,6 +31,11 @@
 
 #include "banshee-player-private.h"
 
-GstElement * _bp_equalizer_new (BansheePlayer *player);
+GstElement * _bp_equalizer_new              (BansheePlayer *player);
+void         _bp_equalizer_pipeline_setup   (BansheePlayer *player, GstElement *upstream, 
+                                             GstElement *downstream);
+void         _bp_equalizer_pipeline_destroy (BansheePlayer *player);
+
+gboolean     bp_equalizer_is_supported      (BansheePlayer *player);
 
 #endif /* _BANSHEE_PLAYER_EQUALIZER_H */
@@ -0,0 +1,486 @@
+//
+// banshee-player-events.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <string.h>
+
+#include "banshee-player-events.h"
+
+#define BP_EVENT_RING_SIZE     256
+#define BP_VIS_EVENT_RING_SIZE 4
+
+// Each ring has exactly one producer and one consumer. The producer owns
+// head and every slot from tail up to head; the consumer owns tail. Slots
+// handed out by bp_poll_events stay reserved (and their strings and
+// buffers valid) until the next poll releases them by advancing tail.
+//
+// Bus events may come from the bus watch, the iterate timer and async
+// completions, which are serialised by a producer lock so they act as
+// one producer. Visualization frames have their own ring since they are
+// produced on the vis analysis worker. The consumer never takes a lock.
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static BpEventRing *
+bp_events_ring_new (guint size)
+{
+    BpEventRing *ring = g_new0 (BpEventRing, 1);
+    ring->slots = g_new0 (BpEvent, size);
+    ring->mask = size - 1;
+    return ring;
+}
+
+static void
+bp_events_slot_clear (BpEvent *event)
+{
+    g_free (event->string_value);
+    g_free (event->detail);
+    event->string_value = NULL;
+    event->detail = NULL;
+}
+
+static void
+bp_events_ring_free (BpEventRing *ring)
+{
+    guint i;
+    
+    for (i = 0; i <= ring->mask; i++) {
+        bp_events_slot_clear (&ring->slots[i]);
+        g_free (ring->slots[i].samples);
+        g_free (ring->slots[i].spectrum);
+    }
+    
+    g_free (ring->slots);
+    g_free (ring);
+}
+
+static BpEvent *
+bp_events_ring_reserve (BpEventRing *ring)
+{
+    guint head = (guint)ring->head;
+    guint tail = (guint)g_atomic_int_get (&ring->tail);
+    
+    if (head - tail > ring->mask) {
+        return NULL;
+    }
+    
+    return &ring->slots[head & ring->mask];
+}
+
+static void
+bp_events_ring_commit (BpEventRing *ring)
+{
+    g_atomic_int_set (&ring->head, (gint)((guint)ring->head + 1));
+}
+
+static gint
+bp_events_ring_drain (BpEventRing *ring, BpEvent *events, gint max_events)
+{
+    guint tail, head, available, i;
+    
+    // Release whatever the previous poll handed out
+    tail = (guint)ring->tail + ring->held;
+    g_atomic_int_set (&ring->tail, (gint)tail);
+    ring->held = 0;
+    
+    head = (guint)g_atomic_int_get (&ring->head);
+    available = MIN (head - tail, (guint)max_events);
+    
+    for (i = 0; i < available; i++) {
+        events[i] = ring->slots[(tail + i) & ring->mask];
+    }
+    
+    ring->held = available;
+    return available;
+}
+
+static BpEvent *
+bp_events_begin (BansheePlayer *player, BpEventType type)
+{
+    BpEvent *event;
+    
+    g_mutex_lock (player->events_mutex);
+    
+    if ((event = bp_events_ring_reserve (player->event_ring)) == NULL) {
+        player->events_dropped++;
+        g_mutex_unlock (player->events_mutex);
+        return NULL;
+    }
+    
+    bp_events_slot_clear (event);
+    event->timestamp = gst_util_get_timestamp () / GST_USECOND;
+    event->int_value = 0;
+    event->double_value = 0.0;
+    event->name = NULL;
+    event->samples = NULL;
+    event->spectrum = NULL;
+    event->type = type;
+    event->arg0 = event->arg1 = event->arg2 = event->arg3 = 0;
+    
+    return event;
+}
+
+static void
+bp_events_end (BansheePlayer *player)
+{
+    bp_events_ring_commit (player->event_ring);
+    g_mutex_unlock (player->events_mutex);
+}
+
+static inline void
+bp_events_count (BansheePlayer *player, BpEventType type)
+{
+    g_atomic_int_inc ((volatile gint *)&player->event_counts[type]);
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void
+_bp_events_destroy (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    player->events_enabled = FALSE;
+    
+    if (player->event_ring != NULL) {
+        bp_events_ring_free (player->event_ring);
+        player->event_ring = NULL;
+    }
+    
+    if (player->vis_event_ring != NULL) {
+        bp_events_ring_free (player->vis_event_ring);
+        player->vis_event_ring = NULL;
+    }
+    
+    if (player->events_mutex != NULL) {
+        g_mutex_free (player->events_mutex);
+        player->events_mutex = NULL;
+    }
+}
+
+void
+_bp_events_emit_eos (BansheePlayer *player)
+{
+    bp_events_count (player, BP_EVENT_EOS);
+    
+    if (!player->events_enabled) {
+        if (player->eos_cb != NULL) {
+            player->eos_cb (player);
+        }
+    } else if (bp_events_begin (player, BP_EVENT_EOS) != NULL) {
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_error (BansheePlayer *player, GQuark domain, gint code, 
+    const gchar *error, const gchar *debug)
+{
+    BpEvent *event;
+    
+    bp_events_count (player, BP_EVENT_ERROR);
+    
+    if (!player->events_enabled) {
+        if (player->error_cb != NULL) {
+            player->error_cb (player, domain, code, error, debug);
+        }
+    } else if ((event = bp_events_begin (player, BP_EVENT_ERROR)) != NULL) {
+        event->arg0 = domain;
+        event->arg1 = code;
+        event->string_value = g_strdup (error);
+        event->detail = g_strdup (debug);
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_state_changed (BansheePlayer *player, GstState old, GstState new, GstState pending)
+{
+    BpEvent *event;
+    
+    bp_events_count (player, BP_EVENT_STATE_CHANGED);
+    
+    if (!player->events_enabled) {
+        if (player->state_changed_cb != NULL) {
+            player->state_changed_cb (player, old, new, pending);
+        }
+    } else if ((event = bp_events_begin (player, BP_EVENT_STATE_CHANGED)) != NULL) {
+        event->arg0 = old;
+        event->arg1 = new;
+        event->arg2 = pending;
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_buffering (BansheePlayer *player, gint progress)
+{
+    BpEvent *event;
+    
+    bp_events_count (player, BP_EVENT_BUFFERING);
+    
+    if (!player->events_enabled) {
+        if (player->buffering_cb != NULL) {
+            player->buffering_cb (player, progress);
+        }
+    } else if ((event = bp_events_begin (player, BP_EVENT_BUFFERING)) != NULL) {
+        event->arg0 = progress;
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_tags (BansheePlayer *player, const BpTag *tags, gint count)
+{
+    BpEvent *event;
+    gint i;
+    
+    bp_events_count (player, BP_EVENT_TAG);
+    
+    if (!player->events_enabled) {
+        if (player->tags_found_cb != NULL) {
+            player->tags_found_cb (player, tags, count);
+        }
+        return;
+    }
+    
+    for (i = 0; i < count; i++) {
+        if ((event = bp_events_begin (player, BP_EVENT_TAG)) == NULL) {
+            return;
+        }
+        
+        event->name = tags[i].name;
+        event->arg0 = tags[i].type;
+        event->arg1 = tags[i].quark;
+        event->int_value = tags[i].int_value;
+        event->double_value = tags[i].double_value;
+        event->string_value = g_strdup (tags[i].string_value);
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_iterate (BansheePlayer *player)
+{
+    bp_events_count (player, BP_EVENT_ITERATE);
+    
+    if (!player->events_enabled) {
+        if (player->iterate_cb != NULL) {
+            player->iterate_cb (player);
+        }
+    } else if (bp_events_begin (player, BP_EVENT_ITERATE) != NULL) {
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_next_track_starting (BansheePlayer *player)
+{
+    bp_events_count (player, BP_EVENT_NEXT_TRACK_STARTING);
+    
+    if (!player->events_enabled) {
+        if (player->next_track_starting_cb != NULL) {
+            player->next_track_starting_cb (player);
+        }
+    } else if (bp_events_begin (player, BP_EVENT_NEXT_TRACK_STARTING) != NULL) {
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_async_done (BansheePlayer *player, BpAsyncOperation operation, 
+    gboolean success, guint64 latency_us)
+{
+    BpEvent *event;
+    
+    bp_events_count (player, BP_EVENT_ASYNC_DONE);
+    
+    if (!player->events_enabled) {
+        if (player->async_done_cb != NULL) {
+            player->async_done_cb (player, operation, success, latency_us);
+        }
+    } else if ((event = bp_events_begin (player, BP_EVENT_ASYNC_DONE)) != NULL) {
+        event->arg0 = operation;
+        event->arg1 = success;
+        event->int_value = latency_us;
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_seek_done (BansheePlayer *player, guint64 position_ms, guint64 latency_us)
+{
+    BpEvent *event;
+    
+    bp_events_count (player, BP_EVENT_SEEK_DONE);
+    
+    if (!player->events_enabled) {
+        if (player->seek_done_cb != NULL) {
+            player->seek_done_cb (player, position_ms, latency_us);
+        }
+    } else if ((event = bp_events_begin (player, BP_EVENT_SEEK_DONE)) != NULL) {
+        event->int_value = position_ms;
+        event->double_value = latency_us;
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_health (BansheePlayer *player, const BpHealthStats *stats)
+{
+    BpEvent *event;
+    
+    bp_events_count (player, BP_EVENT_HEALTH);
+    
+    if (!player->events_enabled) {
+        if (player->health_cb != NULL) {
+            player->health_cb (player, stats);
+        }
+    } else if ((event = bp_events_begin (player, BP_EVENT_HEALTH)) != NULL) {
+        event->arg0 = stats->queue_underruns;
+        event->arg1 = stats->queue_overruns;
+        event->arg2 = stats->vis_queue_drops;
+        event->arg3 = stats->late_buffers;
+        event->int_value = stats->queue_level_time;
+        bp_events_end (player);
+    }
+}
+
+void
+_bp_events_emit_vis_data (BansheePlayer *player, gint channels, gint samples, 
+    gfloat *data, gint bands, gfloat *spectrum)
+{
+    BpEvent *event;
+    
+    bp_events_count (player, BP_EVENT_VIS_DATA);
+    
+    if (!player->events_enabled) {
+        if (player->vis_data_cb != NULL) {
+            player->vis_data_cb (player, channels, samples, data, bands, spectrum);
+        }
+        return;
+    }
+    
+    // The vis analysis worker is the only producer on this ring, and a
+    // frame that does not fit is simply dropped
+    if ((event = bp_events_ring_reserve (player->vis_event_ring)) == NULL) {
+        g_atomic_int_inc (&player->vis_events_dropped);
+        return;
+    }
+    
+    // Slot buffers are kept from frame to frame; both sizes only
+    // change with the vis config, and there may be no PCM at all
+    if (event->arg0 * event->arg1 != channels * samples) {
+        event->samples = g_renew (gfloat, event->samples, channels * samples);
+        g_atomic_int_inc (&player->vis_allocations);
+    }
+    
+    if (event->spectrum == NULL || event->arg2 != bands) {
+        event->spectrum = g_renew (gfloat, event->spectrum, bands);
+        g_atomic_int_inc (&player->vis_allocations);
+    }
+    
+    if (samples > 0) {
+        memcpy (event->samples, data, sizeof (gfloat) * channels * samples);
+    }
+    memcpy (event->spectrum, spectrum, sizeof (gfloat) * bands);
+    
+    event->timestamp = gst_util_get_timestamp () / GST_USECOND;
+    event->type = BP_EVENT_VIS_DATA;
+    event->arg0 = channels;
+    event->arg1 = samples;
+    event->arg2 = bands;
+    
+    bp_events_ring_commit (player->vis_event_ring);
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE void
+bp_set_events_enabled (BansheePlayer *player, gboolean enabled)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // The rings live as long as the player once created, so a producer
+    // racing with a mode switch never sees them go away
+    if (enabled && player->event_ring == NULL) {
+        player->events_mutex = g_mutex_new ();
+        player->event_ring = bp_events_ring_new (BP_EVENT_RING_SIZE);
+        player->vis_event_ring = bp_events_ring_new (BP_VIS_EVENT_RING_SIZE);
+    }
+    
+    if (player->events_enabled != enabled) {
+        player->events_enabled = enabled;
+        
+        // ITERATE is queued from the timer too, which may have been off
+        // for lack of a callback
+        _bp_iterate_timeout_restart (player);
+    }
+}
+
+P_INVOKE gint
+bp_poll_events (BansheePlayer *player, BpEvent *events, gint max_events)
+{
+    gint count;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
+    g_return_val_if_fail (events != NULL || max_events == 0, 0);
+    
+    if (player->event_ring == NULL) {
+        return 0;
+    }
+    
+    // Everything returned here stays valid until the next call
+    count = bp_events_ring_drain (player->event_ring, events, max_events);
+    count += bp_events_ring_drain (player->vis_event_ring, events + count, max_events - count);
+    
+    return count;
+}
+
+P_INVOKE guint
+bp_get_event_count (BansheePlayer *player, BpEventType type)
+{
+    // A 32 bit count that wraps around; compare two readings with
+    // unsigned 32 bit arithmetic (later - earlier) to get the number
+    // of events in between
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
+    g_return_val_if_fail (type >= 0 && type < BP_EVENT_TYPE_COUNT, 0);
+    return (guint)g_atomic_int_get ((volatile gint *)&player->event_counts[type]);
+}
+
+P_INVOKE guint64
+bp_get_events_dropped (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
+    return player->events_dropped + (guint)g_atomic_int_get (&player->vis_events_dropped);
+}
@@ -0,0 +1,53 @@
+//
+// banshee-player-events.h
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef _BANSHEE_PLAYER_EVENTS_H
+#define _BANSHEE_PLAYER_EVENTS_H
+
+#include "banshee-player-private.h"
+
+void _bp_events_destroy                 (BansheePlayer *player);
+void _bp_events_emit_eos                (BansheePlayer *player);
+void _bp_events_emit_error              (BansheePlayer *player, GQuark domain, gint code, 
+                                         const gchar *error, const gchar *debug);
+void _bp_events_emit_state_changed      (BansheePlayer *player, GstState old, GstState new, GstState pending);
+void _bp_events_emit_buffering          (BansheePlayer *player, gint progress);
+void _bp_events_emit_tags               (BansheePlayer *player, const BpTag *tags, gint count);
+void _bp_events_emit_iterate            (BansheePlayer *player);
+void _bp_events_emit_next_track_starting (BansheePlayer *player);
+void _bp_events_emit_async_done         (BansheePlayer *player, BpAsyncOperation operation, 
+                                         gboolean success, guint64 latency_us);
+void _bp_events_emit_seek_done          (BansheePlayer *player, guint64 position_ms, guint64 latency_us);
+void _bp_events_emit_health             (BansheePlayer *player, const BpHealthStats *stats);
+void _bp_events_emit_vis_data           (BansheePlayer *player, gint channels, gint samples, 
+                                         gfloat *data, gint bands, gfloat *spectrum);
+
+// The iterate timer itself lives in banshee-player.c
+void _bp_iterate_timeout_restart        (BansheePlayer *player);
+
+#endif /* _BANSHEE_PLAYER_EVENTS_H */
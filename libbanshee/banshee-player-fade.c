@@ -0,0 +1,222 @@
+//
+// banshee-player-fade.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "banshee-player-fade.h"
+#include "banshee-player-state.h"
+
+// Fades each track out at its end and the next one in at its start. The
+// tracks never overlap: playbin2 only ever feeds us one decode chain, so
+// a gapless transition dips through silence. A true crossfade would need
+// a second decode chain mixed in through an adder.
+//
+// The ramps are control points on a volume element that sits in front of
+// the audiotee; the controller evaluates them against each buffer's stream
+// time in the streaming thread, so the main loop only ever programs the
+// envelope, never the gain itself.
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+bp_fade_set_point (BansheePlayer *player, GstClockTime time, gdouble volume)
+{
+    GValue value = { 0, };
+    
+    g_value_init (&value, G_TYPE_DOUBLE);
+    g_value_set_double (&value, volume);
+    gst_interpolation_control_source_set (player->fade_control_source, time, &value);
+    g_value_unset (&value);
+}
+
+static void
+bp_fade_program (BansheePlayer *player, GstClockTime duration)
+{
+    GstClockTime fade = player->fade_duration * GST_MSECOND;
+    
+    gst_interpolation_control_source_unset_all (player->fade_control_source);
+    
+    if (fade == 0) {
+        bp_fade_set_point (player, 0, 1.0);
+        return;
+    }
+    
+    // Fade in only when we entered this track through a transition,
+    // otherwise start at full volume as if there were no fading
+    if (player->fade_in) {
+        bp_fade_set_point (player, 0, 0.0);
+        bp_fade_set_point (player, fade, 1.0);
+    } else {
+        bp_fade_set_point (player, 0, 1.0);
+    }
+    
+    // Tracks too short for a fade in and a fade out are left alone
+    if (GST_CLOCK_TIME_IS_VALID (duration) && duration > 2 * fade) {
+        bp_fade_set_point (player, duration - fade, 1.0);
+        bp_fade_set_point (player, duration, 0.0);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+GstElement *
+_bp_fade_new (BansheePlayer *player)
+{
+    #ifdef ENABLE_GAPLESS
+    GstElement *volume;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), NULL);
+    
+    volume = gst_element_factory_make ("volume", "fade-volume");
+    if (volume == NULL) {
+        bp_debug ("Could not create fade volume element, fading is disabled");
+        return NULL;
+    }
+    
+    player->fade_controller = gst_object_control_properties (G_OBJECT (volume), "volume", NULL);
+    if (player->fade_controller == NULL) {
+        bp_debug ("Volume element is not controllable, fading is disabled");
+        gst_object_unref (volume);
+        return NULL;
+    }
+    
+    player->fade_control_source = gst_interpolation_control_source_new ();
+    gst_interpolation_control_source_set_interpolation_mode (player->fade_control_source, 
+        GST_INTERPOLATE_LINEAR);
+    gst_controller_set_control_source (player->fade_controller, "volume", 
+        GST_CONTROL_SOURCE (player->fade_control_source));
+    
+    player->fade_in = FALSE;
+    bp_fade_program (player, GST_CLOCK_TIME_NONE);
+    
+    return volume;
+    #else
+    // Without gapless transitions every track change goes through READY,
+    // where the envelope starts over anyway; don't put a volume element
+    // in the stream for nothing
+    return NULL;
+    #endif
+}
+
+void
+_bp_fade_destroy (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->fade_control_source != NULL) {
+        g_object_unref (player->fade_control_source);
+        player->fade_control_source = NULL;
+    }
+    
+    if (player->fade_controller != NULL) {
+        g_object_unref (player->fade_controller);
+        player->fade_controller = NULL;
+    }
+}
+
+void
+_bp_fade_reset (BansheePlayer *player)
+{
+    // Called on an explicit open; the new track starts at full volume
+    // and gets its fade out once the duration is known
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->fade_control_source == NULL) {
+        return;
+    }
+    
+    player->fade_in = FALSE;
+    bp_fade_program (player, GST_CLOCK_TIME_NONE);
+}
+
+void
+_bp_fade_prepare_transition (BansheePlayer *player)
+{
+    // Called from the streaming thread when the next track has been
+    // queued; the current track is well past its start, so the fade in
+    // points for the incoming track can be added to the existing envelope
+    GstClockTime fade;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->fade_control_source == NULL || player->fade_duration == 0) {
+        return;
+    }
+    
+    fade = player->fade_duration * GST_MSECOND;
+    player->fade_in = TRUE;
+    
+    bp_fade_set_point (player, 0, 0.0);
+    bp_fade_set_point (player, fade, 1.0);
+}
+
+void
+_bp_fade_update (BansheePlayer *player)
+{
+    BpStateSnapshot snapshot;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->fade_control_source == NULL || player->playbin == NULL) {
+        return;
+    }
+    
+    _bp_state_get_snapshot (player, &snapshot);
+    bp_fade_program (player, snapshot.duration > 0 
+        ? snapshot.duration * GST_MSECOND 
+        : GST_CLOCK_TIME_NONE);
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE void
+bp_set_fade_duration (BansheePlayer *player, guint duration_ms)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    player->fade_duration = duration_ms;
+    _bp_fade_update (player);
+}
+
+P_INVOKE guint
+bp_get_fade_duration (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
+    return player->fade_duration;
+}
+
+P_INVOKE gboolean
+bp_fade_is_supported (BansheePlayer *player)
+{
+    // Only built with gapless support, see _bp_fade_new
+    return player != NULL && player->fade_control_source != NULL;
+}
@@ -0,0 +1,397 @@
+//
+// banshee-player-health.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <string.h>
+
+#include "banshee-player-health.h"
+#include "banshee-player-events.h"
+#include "banshee-player-state.h"
+
+// A buffer reaching the sink this long after its running time
+// has passed is counted as late
+#define BP_HEALTH_LATE_THRESHOLD (20 * GST_MSECOND)
+
+// The sink probe only notes the running time of each buffer; whether the
+// newest one was late is judged against the clock when the stats are
+// sampled, so the streaming thread never queries the clock. A buffer is
+// judged once, so a stall counts once per sample it is seen at.
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static gboolean
+bp_health_is_playing (BansheePlayer *player)
+{
+    return player->target_state == GST_STATE_PLAYING && !player->buffering;
+}
+
+static void
+bp_health_queue_underrun (GstElement *queue, BansheePlayer *player)
+{
+    // The queue also drains at EOS and on flushes; only starvation
+    // while we expect to be playing matters
+    if (bp_health_is_playing (player) && !player->health_flushing) {
+        g_atomic_int_inc (&player->health_queue_underruns);
+    }
+}
+
+static void
+bp_health_queue_overrun (GstElement *queue, BansheePlayer *player)
+{
+    g_atomic_int_inc (&player->health_queue_overruns);
+}
+
+static void
+bp_health_vis_queue_overrun (GstElement *queue, BansheePlayer *player)
+{
+    // vis-queue is leaky, so every overrun is a buffer it is about to drop
+    g_atomic_int_inc (&player->health_vis_queue_drops);
+}
+
+static void
+bp_health_set_running_time (BansheePlayer *player, GstClockTime running_time)
+{
+    // Only ever written from the sink's streaming thread
+    g_atomic_int_inc (&player->health_sequence);
+    player->health_running_time = running_time;
+    g_atomic_int_inc (&player->health_sequence);
+}
+
+static GstClockTime
+bp_health_get_running_time (BansheePlayer *player)
+{
+    GstClockTime running_time;
+    gint sequence;
+    
+    do {
+        sequence = g_atomic_int_get (&player->health_sequence);
+        running_time = player->health_running_time;
+    } while ((sequence & 1) != 0 || sequence != g_atomic_int_get (&player->health_sequence));
+    
+    return running_time;
+}
+
+static gboolean
+bp_health_sink_event_probe (GstPad *pad, GstEvent *event, BansheePlayer *player)
+{
+    switch (GST_EVENT_TYPE (event)) {
+        case GST_EVENT_FLUSH_START:
+            player->health_flushing = TRUE;
+            break;
+        case GST_EVENT_FLUSH_STOP:
+            gst_segment_init (&player->health_segment, GST_FORMAT_TIME);
+            bp_health_set_running_time (player, GST_CLOCK_TIME_NONE);
+            player->health_flushing = FALSE;
+            break;
+        case GST_EVENT_NEWSEGMENT: {
+            GstFormat format;
+            gboolean update;
+            gdouble rate, applied_rate;
+            gint64 start, stop, time;
+            
+            gst_event_parse_new_segment_full (event, &update, &rate, &applied_rate, 
+                &format, &start, &stop, &time);
+            
+            if (format == GST_FORMAT_TIME) {
+                gst_segment_set_newsegment_full (&player->health_segment, update, 
+                    rate, applied_rate, format, start, stop, time);
+            }
+            break;
+        }
+        default: break;
+    }
+    
+    return TRUE;
+}
+
+static gboolean
+bp_health_sink_buffer_probe (GstPad *pad, GstBuffer *buffer, BansheePlayer *player)
+{
+    g_atomic_int_inc (&player->health_buffers);
+    
+    if (!GST_BUFFER_TIMESTAMP_IS_VALID (buffer)) {
+        return TRUE;
+    }
+    
+    // Keep the segment's position current, so the running time carries
+    // on across the segments of a gapless transition
+    gst_segment_set_last_stop (&player->health_segment, GST_FORMAT_TIME, 
+        GST_BUFFER_TIMESTAMP (buffer) + (GST_BUFFER_DURATION_IS_VALID (buffer) 
+            ? GST_BUFFER_DURATION (buffer) : 0));
+    
+    bp_health_set_running_time (player, gst_segment_to_running_time (&player->health_segment, 
+        GST_FORMAT_TIME, GST_BUFFER_TIMESTAMP (buffer)));
+    
+    return TRUE;
+}
+
+static void
+bp_health_check_late (BansheePlayer *player)
+{
+    BpStateSnapshot snapshot;
+    GstClockTime running_time;
+    
+    if (!bp_health_is_playing (player) || player->health_flushing) {
+        return;
+    }
+    
+    running_time = bp_health_get_running_time (player);
+    if (!GST_CLOCK_TIME_IS_VALID (running_time) || running_time == player->health_judged_time) {
+        return;
+    }
+    
+    _bp_state_get_snapshot (player, &snapshot);
+    
+    if (snapshot.state != GST_STATE_PLAYING || !GST_CLOCK_TIME_IS_VALID (snapshot.clock_time) ||
+        snapshot.clock_time < snapshot.base_time) {
+        return;
+    }
+    
+    player->health_judged_time = running_time;
+    
+    if (running_time + BP_HEALTH_LATE_THRESHOLD < snapshot.clock_time - snapshot.base_time) {
+        g_atomic_int_inc (&player->health_late_buffers);
+    }
+}
+
+static void
+bp_health_sample (BansheePlayer *player, BpHealthStats *stats)
+{
+    memset (stats, 0, sizeof (BpHealthStats));
+    
+    bp_health_check_late (player);
+    
+    stats->queue_underruns = g_atomic_int_get (&player->health_queue_underruns);
+    stats->queue_overruns = g_atomic_int_get (&player->health_queue_overruns);
+    stats->vis_queue_drops = g_atomic_int_get (&player->health_vis_queue_drops);
+    stats->late_buffers = g_atomic_int_get (&player->health_late_buffers);
+    stats->buffers = g_atomic_int_get (&player->health_buffers);
+    
+    // Queue levels are read under the queue's own lock by the property getters
+    if (player->health_queue != NULL) {
+        g_object_get (player->health_queue,
+            "current-level-buffers", &stats->queue_level_buffers,
+            "current-level-bytes", &stats->queue_level_bytes,
+            "current-level-time", &stats->queue_level_time,
+            NULL);
+    }
+    
+    if (player->health_vis_queue != NULL) {
+        g_object_get (player->health_vis_queue,
+            "current-level-buffers", &stats->vis_queue_level_buffers,
+            "current-level-time", &stats->vis_queue_level_time,
+            NULL);
+    }
+}
+
+static gboolean
+bp_health_timeout (BansheePlayer *player)
+{
+    BpHealthStats stats;
+    GstBus *bus;
+    
+    if (player->playbin == NULL) {
+        return TRUE;
+    }
+    
+    bp_health_sample (player, &stats);
+    
+    bus = gst_element_get_bus (player->playbin);
+    gst_bus_post (bus, gst_message_new_application (GST_OBJECT (player->playbin), 
+        gst_structure_new ("banshee-health",
+            "queue-level-time", G_TYPE_UINT64, stats.queue_level_time,
+            "queue-level-bytes", G_TYPE_UINT, stats.queue_level_bytes,
+            "queue-level-buffers", G_TYPE_UINT, stats.queue_level_buffers,
+            "vis-queue-level-time", G_TYPE_UINT64, stats.vis_queue_level_time,
+            "vis-queue-level-buffers", G_TYPE_UINT, stats.vis_queue_level_buffers,
+            "queue-underruns", G_TYPE_UINT, stats.queue_underruns,
+            "queue-overruns", G_TYPE_UINT, stats.queue_overruns,
+            "vis-queue-drops", G_TYPE_UINT, stats.vis_queue_drops,
+            "late-buffers", G_TYPE_UINT, stats.late_buffers,
+            "buffers", G_TYPE_UINT, stats.buffers,
+            NULL)));
+    gst_object_unref (bus);
+    
+    return TRUE;
+}
+
+static void
+bp_health_timeout_stop (BansheePlayer *player)
+{
+    if (player->health_timeout_id != 0) {
+        g_source_remove (player->health_timeout_id);
+        player->health_timeout_id = 0;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void
+_bp_health_pipeline_setup (BansheePlayer *player, GstElement *audiosinkqueue, GstElement *audiosink)
+{
+    GstPad *pad;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    gst_segment_init (&player->health_segment, GST_FORMAT_TIME);
+    player->health_flushing = FALSE;
+    player->health_running_time = GST_CLOCK_TIME_NONE;
+    player->health_judged_time = GST_CLOCK_TIME_NONE;
+    
+    player->health_queue = audiosinkqueue;
+    g_signal_connect (audiosinkqueue, "underrun", G_CALLBACK (bp_health_queue_underrun), player);
+    g_signal_connect (audiosinkqueue, "overrun", G_CALLBACK (bp_health_queue_overrun), player);
+    
+    if ((pad = gst_element_get_static_pad (audiosink, "sink")) != NULL) {
+        gst_pad_add_event_probe (pad, G_CALLBACK (bp_health_sink_event_probe), player);
+        gst_pad_add_buffer_probe (pad, G_CALLBACK (bp_health_sink_buffer_probe), player);
+        gst_object_unref (pad);
+    }
+    
+    if (player->health_interval > 0 && player->health_timeout_id == 0) {
+        player->health_timeout_id = g_timeout_add (player->health_interval, 
+            (GSourceFunc)bp_health_timeout, player);
+    }
+}
+
+void
+_bp_health_watch_vis_queue (BansheePlayer *player, GstElement *visqueue)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // The vis branch is built on demand, and may be taken down again
+    // before the rest of the pipeline; keep it alive till we let go
+    _bp_health_unwatch_vis_queue (player);
+    player->health_vis_queue = gst_object_ref (visqueue);
+    player->health_vis_queue_handler = g_signal_connect (visqueue, "overrun", 
+        G_CALLBACK (bp_health_vis_queue_overrun), player);
+}
+
+void
+_bp_health_unwatch_vis_queue (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->health_vis_queue == NULL) {
+        return;
+    }
+    
+    g_signal_handler_disconnect (player->health_vis_queue, player->health_vis_queue_handler);
+    gst_object_unref (player->health_vis_queue);
+    player->health_vis_queue = NULL;
+    player->health_vis_queue_handler = 0;
+}
+
+gboolean
+_bp_health_dispatch_message (BansheePlayer *player, GstMessage *message)
+{
+    const GstStructure *structure = gst_message_get_structure (message);
+    BpHealthStats stats;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    if (structure == NULL || !gst_structure_has_name (structure, "banshee-health")) {
+        return FALSE;
+    }
+    
+    memset (&stats, 0, sizeof (BpHealthStats));
+    stats.queue_level_time = g_value_get_uint64 (gst_structure_get_value (structure, "queue-level-time"));
+    gst_structure_get_uint (structure, "queue-level-bytes", &stats.queue_level_bytes);
+    gst_structure_get_uint (structure, "queue-level-buffers", &stats.queue_level_buffers);
+    stats.vis_queue_level_time = g_value_get_uint64 (gst_structure_get_value (structure, "vis-queue-level-time"));
+    gst_structure_get_uint (structure, "vis-queue-level-buffers", &stats.vis_queue_level_buffers);
+    gst_structure_get_uint (structure, "queue-underruns", &stats.queue_underruns);
+    gst_structure_get_uint (structure, "queue-overruns", &stats.queue_overruns);
+    gst_structure_get_uint (structure, "vis-queue-drops", &stats.vis_queue_drops);
+    gst_structure_get_uint (structure, "late-buffers", &stats.late_buffers);
+    gst_structure_get_uint (structure, "buffers", &stats.buffers);
+    
+    _bp_events_emit_health (player, &stats);
+    
+    return TRUE;
+}
+
+void
+_bp_health_pipeline_destroy (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    bp_health_timeout_stop (player);
+    player->health_queue = NULL;
+    _bp_health_unwatch_vis_queue (player);
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE void
+bp_get_health_stats (BansheePlayer *player, BpHealthStats *stats)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    g_return_if_fail (stats != NULL);
+    
+    bp_health_sample (player, stats);
+}
+
+P_INVOKE void
+bp_reset_health_stats (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    g_atomic_int_set (&player->health_queue_underruns, 0);
+    g_atomic_int_set (&player->health_queue_overruns, 0);
+    g_atomic_int_set (&player->health_vis_queue_drops, 0);
+    g_atomic_int_set (&player->health_late_buffers, 0);
+    g_atomic_int_set (&player->health_buffers, 0);
+}
+
+P_INVOKE void
+bp_set_health_callback (BansheePlayer *player, BansheePlayerHealthCallback cb)
+{
+    SET_CALLBACK (health_cb);
+}
+
+P_INVOKE void
+bp_set_health_interval (BansheePlayer *player, guint interval_ms)
+{
+    // Posts a "banshee-health" application message on the pipeline bus
+    // every interval_ms while the pipeline exists, which reaches the host
+    // as a health callback or event; 0 turns it off
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    player->health_interval = interval_ms;
+    bp_health_timeout_stop (player);
+    
+    if (interval_ms > 0 && player->playbin != NULL) {
+        player->health_timeout_id = g_timeout_add (interval_ms, (GSourceFunc)bp_health_timeout, player);
+    }
+}
@@ -0,0 +1,207 @@
+//
+// banshee-player-latency.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <string.h>
+
+#include "banshee-player-latency.h"
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+bp_latency_record (BpLatencyStats *stats, GstClockTime latency)
+{
+    guint64 latency_us = latency / GST_USECOND;
+    guint64 latency_ms = latency / GST_MSECOND;
+    guint bucket = 0;
+    
+    // Bucket n holds latencies below 2^n ms; the last one takes the rest
+    while (bucket < BP_LATENCY_HISTOGRAM_SIZE - 1 && latency_ms >= (G_GUINT64_CONSTANT (1) << bucket)) {
+        bucket++;
+    }
+    
+    stats->histogram[bucket]++;
+    stats->last_us = latency_us;
+    stats->min_us = stats->count == 0 ? latency_us : MIN (stats->min_us, latency_us);
+    stats->max_us = MAX (stats->max_us, latency_us);
+    stats->count++;
+}
+
+static gboolean
+bp_latency_buffer_probe (GstPad *pad, GstBuffer *buffer, BansheePlayer *player)
+{
+    GstClockTime now;
+    
+    // Cheap unlocked check; the sink sees every buffer
+    if (player->latency_armed[BP_LATENCY_STARTUP] == 0 && player->latency_armed[BP_LATENCY_UNPAUSE] == 0 &&
+        ((player->latency_armed[BP_LATENCY_SEEK] == 0 && player->latency_armed[BP_LATENCY_RESUME] == 0) || 
+        !player->latency_seek_flushed)) {
+        return TRUE;
+    }
+    
+    now = gst_util_get_timestamp ();
+    
+    g_mutex_lock (player->mutex);
+    
+    if (player->latency_armed[BP_LATENCY_STARTUP] != 0) {
+        bp_latency_record (&player->latency_stats[BP_LATENCY_STARTUP], 
+            now - player->latency_armed[BP_LATENCY_STARTUP]);
+        player->latency_armed[BP_LATENCY_STARTUP] = 0;
+    }
+    
+    if (player->latency_armed[BP_LATENCY_UNPAUSE] != 0) {
+        bp_latency_record (&player->latency_stats[BP_LATENCY_UNPAUSE], 
+            now - player->latency_armed[BP_LATENCY_UNPAUSE]);
+        player->latency_armed[BP_LATENCY_UNPAUSE] = 0;
+    }
+    
+    // A resume prerolls from the start before it seeks back, so it is
+    // done with the first buffer after that seek's flush
+    if (player->latency_armed[BP_LATENCY_RESUME] != 0 && player->latency_seek_flushed) {
+        bp_latency_record (&player->latency_stats[BP_LATENCY_RESUME], 
+            now - player->latency_armed[BP_LATENCY_RESUME]);
+        player->latency_armed[BP_LATENCY_RESUME] = 0;
+        player->latency_seek_flushed = FALSE;
+    }
+    
+    // Only the flush of the last requested seek counts; coalesced
+    // seeks flush on the way and are still waiting on that one
+    if (player->latency_armed[BP_LATENCY_SEEK] != 0 && player->latency_seek_flushed && 
+        !player->seek_pending) {
+        bp_latency_record (&player->latency_stats[BP_LATENCY_SEEK], 
+            now - player->latency_armed[BP_LATENCY_SEEK]);
+        player->latency_armed[BP_LATENCY_SEEK] = 0;
+        player->latency_seek_flushed = FALSE;
+    }
+    
+    g_mutex_unlock (player->mutex);
+    
+    return TRUE;
+}
+
+static gboolean
+bp_latency_event_probe (GstPad *pad, GstEvent *event, BansheePlayer *player)
+{
+    if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP && (player->latency_armed[BP_LATENCY_SEEK] != 0 ||
+        player->latency_armed[BP_LATENCY_RESUME] != 0)) {
+        player->latency_seek_flushed = TRUE;
+    }
+    
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void
+_bp_latency_pipeline_setup (BansheePlayer *player, GstElement *audiosink)
+{
+    GstPad *pad;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // Measure at the real sink, past the queue and the DSP elements
+    if ((pad = gst_element_get_static_pad (audiosink, "sink")) == NULL) {
+        bp_debug ("Audio sink has no sink pad, latency measurements are disabled");
+        return;
+    }
+    
+    gst_pad_add_buffer_probe (pad, G_CALLBACK (bp_latency_buffer_probe), player);
+    gst_pad_add_event_probe (pad, G_CALLBACK (bp_latency_event_probe), player);
+    gst_object_unref (pad);
+    
+    memset (player->latency_armed, 0, sizeof (player->latency_armed));
+    player->latency_seek_flushed = FALSE;
+}
+
+void
+_bp_latency_arm (BansheePlayer *player, BpLatencyKind kind, gboolean replace)
+{
+    GstClockTime now = gst_util_get_timestamp ();
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    g_return_if_fail (kind < BP_LATENCY_KIND_COUNT);
+    
+    g_mutex_lock (player->mutex);
+    
+    if (replace || player->latency_armed[kind] == 0) {
+        player->latency_armed[kind] = now;
+        
+        if (kind == BP_LATENCY_SEEK || kind == BP_LATENCY_RESUME) {
+            player->latency_seek_flushed = FALSE;
+        }
+        
+        // A new stream abandons any seek still being measured
+        if (kind == BP_LATENCY_STARTUP) {
+            player->latency_armed[BP_LATENCY_SEEK] = 0;
+        }
+    }
+    
+    g_mutex_unlock (player->mutex);
+}
+
+void
+_bp_latency_disarm (BansheePlayer *player, BpLatencyKind kind)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    g_return_if_fail (kind < BP_LATENCY_KIND_COUNT);
+    
+    // Whatever we were waiting for is not going to happen
+    g_mutex_lock (player->mutex);
+    player->latency_armed[kind] = 0;
+    g_mutex_unlock (player->mutex);
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE gboolean
+bp_get_latency_stats (BansheePlayer *player, BpLatencyKind kind, BpLatencyStats *stats)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    g_return_val_if_fail (kind < BP_LATENCY_KIND_COUNT && stats != NULL, FALSE);
+    
+    g_mutex_lock (player->mutex);
+    *stats = player->latency_stats[kind];
+    g_mutex_unlock (player->mutex);
+    
+    return stats->count > 0;
+}
+
+P_INVOKE void
+bp_reset_latency_stats (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    g_mutex_lock (player->mutex);
+    memset (player->latency_stats, 0, sizeof (player->latency_stats));
+    g_mutex_unlock (player->mutex);
+}
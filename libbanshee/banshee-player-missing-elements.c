@@ -27,6 +27,7 @@
 //
 
 #include "banshee-player-missing-elements.h"
+#include "banshee-player-events.h"
 
 // ---------------------------------------------------------------------------
 // Private Functions
@@ -76,9 +77,7 @@ bp_missing_elements_handle_install_failed (BansheePlayer *player)
         gst_element_set_state (player->playbin, GST_STATE_READY);
     }
     
-    if (player->error_cb != NULL) {
-        player->error_cb (player, GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN, NULL, NULL);
-    }
+    _bp_events_emit_error (player, GST_CORE_ERROR, GST_CORE_ERROR_MISSING_PLUGIN, NULL, NULL);
 }
 
 static void
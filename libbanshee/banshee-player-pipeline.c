@@ -28,10 +28,21 @@
 
 #include "banshee-player-pipeline.h"
 #include "banshee-player-cdda.h"
+#include "banshee-player-fade.h"
 #include "banshee-player-video.h"
 #include "banshee-player-equalizer.h"
+#include "banshee-player-health.h"
+#include "banshee-player-latency.h"
+#include "banshee-player-events.h"
 #include "banshee-player-missing-elements.h"
+#include "banshee-player-profile.h"
 #include "banshee-player-replaygain.h"
+#include "banshee-player-seek.h"
+#include "banshee-player-threads.h"
+#include "banshee-player-state.h"
+#include "banshee-player-suspend.h"
+#include "banshee-player-tags.h"
+#include "banshee-player-tee.h"
 #include "banshee-player-vis.h"
 
 // ---------------------------------------------------------------------------
@@ -39,54 +50,120 @@
 // ---------------------------------------------------------------------------
 
 static void
-bp_pipeline_process_tag (const GstTagList *tag_list, const gchar *tag_name, BansheePlayer *player)
+bp_pipeline_iterate (BansheePlayer *player)
 {
-    const GValue *value;
-    gint value_count;
-    
-    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    // Event driven iteration, in addition to the periodic timeout
+    _bp_events_emit_iterate (player);
+}
 
-    value_count = gst_tag_list_get_tag_size (tag_list, tag_name);
-    if (value_count < 1) {
-        return;
+static gboolean
+bp_pipeline_is_ignored_error (GstMessage *message)
+{
+    // FIXME: This is to work around a bug in qtdemux in
+    // -good <= 0.10.6
+    return message->src != NULL && message->src->name != NULL && 
+        strncmp (message->src->name, "qtdemux", 7) == 0;
+}
+
+static gboolean
+bp_pipeline_is_stream_error (BansheePlayer *player, GstMessage *message)
+{
+    GError *error = NULL;
+    gboolean stream_error;
+    
+    // Anything going wrong in our own sink chain means rebuilding it
+    if (player->audiobin != NULL && GST_MESSAGE_SRC (message) != NULL &&
+        gst_object_has_ancestor (GST_MESSAGE_SRC (message), GST_OBJECT (player->audiobin))) {
+        return FALSE;
     }
     
-    value = gst_tag_list_get_value_index (tag_list, tag_name, 0);
+    // Sources that can't be read, streams that can't be demuxed or decoded
+    // and decoders we don't have are all about the current track only
+    gst_message_parse_error (message, &error, NULL);
+    stream_error = error->domain == GST_RESOURCE_ERROR || error->domain == GST_STREAM_ERROR ||
+        (error->domain == GST_CORE_ERROR && error->code == GST_CORE_ERROR_MISSING_PLUGIN);
+    g_error_free (error);
+    
+    return stream_error;
+}
 
-    if (value != NULL) {
-        _bp_replaygain_process_tag (player, tag_name, value);
+static void
+bp_pipeline_reset_stream (BansheePlayer *player)
+{
+    // Taking playbin to NULL drops the source and decoders; the audio bin
+    // (sink, EQ, vis and their state) is kept for the next track
+    bp_debug ("Stream error, resetting playbin and keeping the audio sink");
     
-        if (player->tag_found_cb != NULL) {
-            player->tag_found_cb (player, tag_name, value);
-        }
+    player->target_state = GST_STATE_NULL;
+    gst_element_set_state (player->playbin, GST_STATE_NULL);
+    
+    _bp_seek_reset (player);
+    _bp_suspend_reset (player);
+    g_atomic_int_set (&player->next_track_pending, FALSE);
+    
+    if (player->vis_buffer != NULL) {
+        gst_adapter_clear (player->vis_buffer);
     }
 }
 
 static gboolean
-bp_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer userdata)
+bp_pipeline_is_stream_changed (GstMessage *message)
 {
-    BansheePlayer *player = (BansheePlayer *)userdata;
+    const GstStructure *structure = gst_message_get_structure (message);
+    return structure != NULL && gst_structure_has_name (structure, "stream-changed");
+}
 
-    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
-    g_return_val_if_fail (message != NULL, FALSE);
+static gboolean
+bp_pipeline_is_seek_done (GstMessage *message)
+{
+    const GstStructure *structure = gst_message_get_structure (message);
+    return structure != NULL && gst_structure_has_name (structure, "seek-done");
+}
+
+static void
+bp_pipeline_handle_message (BansheePlayer *player, GstMessage *message)
+{
+    // Internal bookkeeping; this tears down and changes the state of the
+    // pipeline and may bring up the missing elements installer, so it
+    // always runs on the main (or callback) context, never the bus thread
+    
+    bp_pipeline_lock (player);
+    
+    // A marshalled message can outlive the pipeline that posted it
+    if (player->playbin == NULL || (GST_MESSAGE_SRC (message) != NULL && 
+        GST_MESSAGE_SRC (message) != GST_OBJECT (player->playbin) &&
+        !gst_object_has_ancestor (GST_MESSAGE_SRC (message), GST_OBJECT (player->playbin)))) {
+        bp_pipeline_unlock (player);
+        return;
+    }
     
     switch (GST_MESSAGE_TYPE (message)) {
-        case GST_MESSAGE_EOS: {
-            if (player->eos_cb != NULL) {
-                player->eos_cb (player);
-            }
-            break;
-        }
-            
         case GST_MESSAGE_STATE_CHANGED: {
             GstState old, new, pending;
+            
             gst_message_parse_state_changed (message, &old, &new, &pending);
             
             _bp_missing_elements_handle_state_changed (player, old, new);
             _bp_replaygain_handle_state_changed (player, old, new, pending);
             
-            if (player->state_changed_cb != NULL) {
-                player->state_changed_cb (player, old, new, pending);
+            // Every element in the pipeline posts its own transitions;
+            // only the top level bin describes the player's state
+            if (GST_MESSAGE_SRC (message) != GST_OBJECT (player->playbin)) {
+                break;
+            }
+            
+            // Running time starts over once the stream is back in READY,
+            // without a flush to tell the segment probe
+            if (new <= GST_STATE_READY && player->segment != NULL) {
+                gst_segment_init (player->segment, GST_FORMAT_TIME);
+                player->last_buffer_end = GST_CLOCK_TIME_NONE;
+            }
+            
+            _bp_state_handle_state_changed (player, old, new);
+            
+            if (old == GST_STATE_READY && new == GST_STATE_PAUSED) {
+                _bp_state_refresh_duration (player);
+                _bp_fade_update (player);
             }
             break;
         }
@@ -114,9 +191,145 @@ bp_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer userdata)
                 }
                 player->buffering = TRUE;
             } 
+            break;
+        }
+        
+        case GST_MESSAGE_TAG: {
+            GstTagList *tags;
+            
+            gst_message_parse_tag (message, &tags);
+            
+            if (GST_IS_TAG_LIST (tags)) {
+                _bp_replaygain_process_tag_list (player, tags);
+                gst_tag_list_free (tags);
+            }
+            break;
+        }
+    
+        case GST_MESSAGE_ERROR: {
+            if (bp_pipeline_is_ignored_error (message)) {
+                break;
+            } else if (bp_pipeline_is_stream_error (player, message)) {
+                bp_pipeline_reset_stream (player);
+            } else {
+                bp_debug ("Fatal pipeline error, destroying the pipeline");
+                _bp_pipeline_destroy (player);
+            }
+            break;
+        } 
+        
+        case GST_MESSAGE_ELEMENT: {
+            _bp_missing_elements_process_message (player, message);
+            break;
+        }
+        
+        case GST_MESSAGE_DURATION: {
+            _bp_state_refresh_duration (player);
+            _bp_fade_update (player);
+            break;
+        }
+        
+        case GST_MESSAGE_ASYNC_DONE: {
+            _bp_seek_handle_async_done (player);
+            _bp_suspend_handle_async_done (player);
+            break;
+        }
+        
+        case GST_MESSAGE_APPLICATION: {
+            if (bp_pipeline_is_stream_changed (message)) {
+                // The next track is playing now, pick up its duration
+                // and program its fade out
+                _bp_state_refresh_duration (player);
+                _bp_fade_update (player);
+            }
+            break;
+        }
+        
+        default: break;
+    }
+    
+    bp_pipeline_unlock (player);
+}
 
-            if (player->buffering_cb != NULL) {
-                player->buffering_cb (player, buffering_progress);
+static gboolean
+bp_pipeline_should_report_state_changed (BansheePlayer *player, GstMessage *message,
+    GstState old, GstState new, GstState pending)
+{
+    // Called with the pipeline lock held
+    
+    if (player->playbin == NULL || GST_MESSAGE_SRC (message) != GST_OBJECT (player->playbin)) {
+        return FALSE;
+    }
+    
+    // A suspended player is still in the state it was suspended in as far
+    // as the host knows, see banshee-player-suspend.c
+    if (player->suspend_phase != BP_SUSPEND_NONE) {
+        return FALSE;
+    }
+    
+    // Coalesce the READY step of a transition still in progress (NULL to
+    // READY on the way up, PAUSED to READY on the way down); it carries
+    // nothing the host acts upon and the next message follows right away
+    if (new == GST_STATE_READY && pending != GST_STATE_VOID_PENDING) {
+        return FALSE;
+    }
+    
+    // Nor report the same transition twice in a row
+    if (old == player->reported_old_state && new == player->reported_new_state && 
+        pending == player->reported_pending_state) {
+        return FALSE;
+    }
+    
+    player->reported_old_state = old;
+    player->reported_new_state = new;
+    player->reported_pending_state = pending;
+    
+    return TRUE;
+}
+
+static void
+bp_pipeline_dispatch_message (BansheePlayer *player, GstMessage *message)
+{
+    // Host callbacks; these always run after our own handling of the same
+    // message, and outside the pipeline lock so the host may call back in
+    
+    switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_EOS: {
+            _bp_events_emit_eos (player);
+            break;
+        }
+            
+        case GST_MESSAGE_STATE_CHANGED: {
+            GstState old, new, pending;
+            gboolean report;
+            
+            gst_message_parse_state_changed (message, &old, &new, &pending);
+            
+            if (player->element_state_changed_cb != NULL) {
+                player->element_state_changed_cb (player, GST_OBJECT_NAME (GST_MESSAGE_SRC (message)), 
+                    old, new, pending);
+            }
+            
+            if (player->state_changed_cb == NULL && !player->events_enabled) {
+                break;
+            }
+            
+            bp_pipeline_lock (player);
+            report = bp_pipeline_should_report_state_changed (player, message, old, new, pending);
+            bp_pipeline_unlock (player);
+            
+            if (report) {
+                _bp_events_emit_state_changed (player, old, new, pending);
+            }
+            break;
+        }
+        
+        case GST_MESSAGE_BUFFERING: {
+            gint buffering_progress = 0;
+            
+            if (gst_structure_get_int (gst_message_get_structure (message), 
+                "buffer-percent", &buffering_progress)) {
+                _bp_events_emit_buffering (player, buffering_progress);
             }
             break;
         }
@@ -124,14 +337,15 @@ bp_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer userdata)
         case GST_MESSAGE_TAG: {
             GstTagList *tags;
             
-            if (GST_MESSAGE_TYPE (message) != GST_MESSAGE_TAG) {
+            if (player->tag_found_cb == NULL && player->tags_found_cb == NULL && 
+                !player->events_enabled) {
                 break;
             }
             
             gst_message_parse_tag (message, &tags);
             
             if (GST_IS_TAG_LIST (tags)) {
-                gst_tag_list_foreach (tags, (GstTagForeachFunc)bp_pipeline_process_tag, player);
+                _bp_tags_dispatch (player, tags);
                 gst_tag_list_free (tags);
             }
             break;
@@ -141,36 +355,408 @@ bp_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer userdata)
             GError *error;
             gchar *debug;
             
-            // FIXME: This is to work around a bug in qtdemux in
-            // -good <= 0.10.6
-            if (message->src != NULL && message->src->name != NULL && 
-                strncmp (message->src->name, "qtdemux", 7) == 0) {
+            if (bp_pipeline_is_ignored_error (message)) {
                 break;
             }
             
-            _bp_pipeline_destroy (player);
-            
-            if (player->error_cb != NULL) {
-                gst_message_parse_error (message, &error, &debug);
-                player->error_cb (player, error->domain, error->code, error->message, debug);
-                g_error_free (error);
-                g_free (debug);
-            }
+            gst_message_parse_error (message, &error, &debug);
+            _bp_events_emit_error (player, error->domain, error->code, error->message, debug);
+            g_error_free (error);
+            g_free (debug);
             
             break;
         } 
         
-        case GST_MESSAGE_ELEMENT: {
-            _bp_missing_elements_process_message (player, message);
+        case GST_MESSAGE_DURATION:
+        case GST_MESSAGE_ASYNC_DONE: {
+            // A preroll or a seek has completed, the position just jumped
+            bp_pipeline_iterate (player);
+            break;
+        }
+        
+        case GST_MESSAGE_APPLICATION: {
+            if (_bp_health_dispatch_message (player, message)) {
+                break;
+            } else if (bp_pipeline_is_seek_done (message)) {
+                const GstStructure *structure = gst_message_get_structure (message);
+                _bp_events_emit_seek_done (player, 
+                    g_value_get_uint64 (gst_structure_get_value (structure, "position")),
+                    g_value_get_uint64 (gst_structure_get_value (structure, "latency")));
+                bp_pipeline_iterate (player);
+                break;
+            } else if (!bp_pipeline_is_stream_changed (message)) {
+                break;
+            }
+            
+            _bp_tags_reset (player);
+            
+            _bp_events_emit_next_track_starting (player);
+            bp_pipeline_iterate (player);
             break;
         }
         
         default: break;
     }
+}
+
+static gboolean
+bp_pipeline_dispatch_marshalled (BpMarshalledMessage *marshalled)
+{
+    BansheePlayer *player = marshalled->player;
+    
+    g_mutex_lock (player->mutex);
+    player->bus_marshalled = g_slist_remove (player->bus_marshalled, marshalled);
+    g_mutex_unlock (player->mutex);
+    
+    bp_pipeline_handle_message (player, marshalled->message);
+    bp_pipeline_dispatch_message (player, marshalled->message);
+    
+    return FALSE;
+}
+
+static void
+bp_pipeline_marshalled_free (BpMarshalledMessage *marshalled)
+{
+    gst_message_unref (marshalled->message);
+    g_free (marshalled);
+}
+
+static void
+bp_pipeline_marshal_message (BansheePlayer *player, GstMessage *message)
+{
+    BpMarshalledMessage *marshalled;
+    
+    marshalled = g_new0 (BpMarshalledMessage, 1);
+    marshalled->player = player;
+    marshalled->message = gst_message_ref (message);
+    marshalled->source = g_idle_source_new ();
+    g_source_set_callback (marshalled->source, (GSourceFunc)bp_pipeline_dispatch_marshalled,
+        marshalled, (GDestroyNotify)bp_pipeline_marshalled_free);
+    
+    // With no callback context, everything goes to the default main context
+    g_mutex_lock (player->mutex);
+    player->bus_marshalled = g_slist_prepend (player->bus_marshalled, marshalled);
+    g_source_attach (marshalled->source, player->bus_callback_context);
+    g_source_unref (marshalled->source);
+    g_mutex_unlock (player->mutex);
+}
+
+static gboolean
+bp_pipeline_bus_callback (GstBus *bus, GstMessage *message, gpointer userdata)
+{
+    BansheePlayer *player = (BansheePlayer *)userdata;
+
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    g_return_val_if_fail (message != NULL, FALSE);
+    
+    if (player->bus_thread == NULL) {
+        bp_pipeline_handle_message (player, message);
+        bp_pipeline_dispatch_message (player, message);
+        return TRUE;
+    }
+    
+    // The bus has its own thread; all we do here is hold on to the message
+    // and hand it over, so that the host never hears of a message before
+    // the player has handled it itself
+    bp_pipeline_marshal_message (player, message);
     
     return TRUE;
 }
 
+static gpointer
+bp_pipeline_bus_thread (BansheePlayer *player)
+{
+    g_main_loop_run (player->bus_loop);
+    return NULL;
+}
+
+static gboolean
+bp_pipeline_bus_thread_quit (BansheePlayer *player)
+{
+    g_main_loop_quit (player->bus_loop);
+    return FALSE;
+}
+
+static void
+bp_pipeline_bus_watch (BansheePlayer *player, GstBus *bus)
+{
+    if (player->bus_thread_enabled && player->bus_thread == NULL) {
+        GError *error = NULL;
+        
+        player->bus_context = g_main_context_new ();
+        player->bus_loop = g_main_loop_new (player->bus_context, FALSE);
+        player->bus_thread = g_thread_create ((GThreadFunc)bp_pipeline_bus_thread, player, TRUE, &error);
+        
+        if (player->bus_thread == NULL) {
+            g_warning ("Could not start bus dispatch thread, using the default main context: %s", 
+                error->message);
+            g_error_free (error);
+            g_main_loop_unref (player->bus_loop);
+            g_main_context_unref (player->bus_context);
+            player->bus_loop = NULL;
+            player->bus_context = NULL;
+        }
+    }
+    
+    player->bus_watch = gst_bus_create_watch (bus);
+    g_source_set_callback (player->bus_watch, (GSourceFunc)bp_pipeline_bus_callback, player, NULL);
+    g_source_attach (player->bus_watch, player->bus_context);
+}
+
+static gboolean
+bp_pipeline_event_probe (GstPad *pad, GstEvent *event, BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), TRUE);
+
+    switch (GST_EVENT_TYPE (event)) {
+        case GST_EVENT_FLUSH_STOP: {
+            gst_segment_init (player->segment, GST_FORMAT_TIME);
+            player->last_buffer_end = GST_CLOCK_TIME_NONE;
+            _bp_state_handle_flush (player);
+            break;
+        }
+
+        case GST_EVENT_NEWSEGMENT: {
+            gboolean update;
+            gdouble rate, applied_rate;
+            GstFormat format;
+            gint64 start, stop, position;
+
+            gst_event_parse_new_segment_full (event, &update, &rate, &applied_rate,
+                &format, &start, &stop, &position);
+
+            if (format == GST_FORMAT_TIME) {
+                gst_segment_set_newsegment_full (player->segment, update, rate, applied_rate,
+                    format, start, stop, position);
+                _bp_state_handle_segment (player, player->segment, 
+                    update ? GST_CLOCK_TIME_NONE : player->last_buffer_end);
+            }
+
+            // The first segment after a gapless URI switch marks the start of
+            // the next track; let the main loop know through the bus
+            if (!update && g_atomic_int_compare_and_exchange (&player->next_track_pending, TRUE, FALSE)) {
+                g_atomic_int_set (&player->measure_transition_gap, TRUE);
+                gst_element_post_message (player->playbin, gst_message_new_application (
+                    GST_OBJECT (player->playbin), gst_structure_new ("stream-changed", NULL)));
+            }
+            break;
+        }
+
+        default: break;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+bp_pipeline_buffer_probe (GstPad *pad, GstBuffer *buffer, BansheePlayer *player)
+{
+    GstClockTime running_time, stop;
+    GstClockTimeDiff gap;
+
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), TRUE);
+
+    if (!GST_BUFFER_TIMESTAMP_IS_VALID (buffer)) {
+        return TRUE;
+    }
+
+    // Keep the segment's position up to date, so that when the next track's
+    // segment comes in (with no stop of its own) the running time
+    // accumulates by what was actually played
+    stop = GST_BUFFER_TIMESTAMP (buffer);
+    if (GST_BUFFER_DURATION_IS_VALID (buffer)) {
+        stop += GST_BUFFER_DURATION (buffer);
+    }
+    gst_segment_set_last_stop (player->segment, GST_FORMAT_TIME, stop);
+
+    running_time = gst_segment_to_running_time (player->segment, GST_FORMAT_TIME,
+        GST_BUFFER_TIMESTAMP (buffer));
+
+    if (!GST_CLOCK_TIME_IS_VALID (running_time)) {
+        return TRUE;
+    }
+
+    if (g_atomic_int_compare_and_exchange (&player->measure_transition_gap, TRUE, FALSE) && 
+        GST_CLOCK_TIME_IS_VALID (player->last_buffer_end)) {
+        // Silence (or overlap, if negative) inserted between the last sample
+        // of the previous track and the first sample of the new one
+        gap = GST_CLOCK_DIFF (player->last_buffer_end, running_time);
+        bp_debug ("Gapless transition gap: %" G_GINT64_FORMAT " ns", gap);
+        
+        g_mutex_lock (player->mutex);
+        player->transition_gap = gap;
+        g_mutex_unlock (player->mutex);
+    }
+
+    player->last_buffer_end = running_time;
+
+    if (GST_BUFFER_DURATION_IS_VALID (buffer)) {
+        player->last_buffer_end += GST_BUFFER_DURATION (buffer);
+    }
+
+    return TRUE;
+}
+
+#ifdef ENABLE_GAPLESS
+
+static void
+bp_pipeline_about_to_finish (GstElement *playbin, BansheePlayer *player)
+{
+    gchar *uri;
+
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+
+    // Give the host a chance to queue up the next track; this is
+    // called from a streaming thread while the current track drains
+    if (player->about_to_finish_cb != NULL) {
+        player->about_to_finish_cb (player);
+    }
+
+    g_mutex_lock (player->mutex);
+    uri = player->next_uri;
+    player->next_uri = NULL;
+    g_mutex_unlock (player->mutex);
+
+    if (uri == NULL) {
+        // Nothing queued, so playbin2 will post EOS as usual
+        return;
+    }
+
+    bp_debug ("Prerolling next track for gapless transition (%s)", uri);
+
+    // playbin2 prerolls the new URI in a second decode chain and
+    // switches over to it in our audiobin once the current one drains
+    _bp_fade_prepare_transition (player);
+    g_atomic_int_set (&player->next_track_pending, TRUE);
+    g_object_set (G_OBJECT (playbin), "uri", uri, NULL);
+    g_free (uri);
+}
+
+#endif
+
+// Try to find an audio sink, prefer gconf, which typically is set to auto these days,
+// fall back on auto, which should work on windows, and as a last ditch, try alsa
+static const gchar *bp_pipeline_audiosinks[] = {
+    "gconfaudiosink",
+    "directsoundsink",
+    "autoaudiosink",
+    "alsasink",
+    NULL
+};
+
+static gchar *
+bp_pipeline_sink_cache_path ()
+{
+    return g_build_filename (g_get_user_cache_dir (), "banshee-1", "audio-sink", NULL);
+}
+
+static gint
+bp_pipeline_sink_cache_load ()
+{
+    GKeyFile *key_file;
+    gchar *path, *factory, *version, *gst_version;
+    gint i, index = -1;
+    
+    path = bp_pipeline_sink_cache_path ();
+    key_file = g_key_file_new ();
+    
+    if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free (key_file);
+        g_free (path);
+        return -1;
+    }
+    
+    factory = g_key_file_get_string (key_file, "AudioSink", "Factory", NULL);
+    version = g_key_file_get_string (key_file, "AudioSink", "GStreamer", NULL);
+    gst_version = gst_version_string ();
+    
+    // Only trust the cache for the GStreamer it was written with, and only
+    // for a sink we would have picked ourselves
+    if (factory != NULL && version != NULL && strcmp (version, gst_version) == 0) {
+        for (i = 0; bp_pipeline_audiosinks[i] != NULL; i++) {
+            if (strcmp (factory, bp_pipeline_audiosinks[i]) == 0) {
+                index = i;
+                break;
+            }
+        }
+    }
+    
+    g_free (gst_version);
+    g_free (version);
+    g_free (factory);
+    g_key_file_free (key_file);
+    g_free (path);
+    
+    return index;
+}
+
+static void
+bp_pipeline_sink_cache_save (gint index)
+{
+    GKeyFile *key_file;
+    gchar *path, *dir, *data, *gst_version;
+    gsize length;
+    
+    path = bp_pipeline_sink_cache_path ();
+    dir = g_path_get_dirname (path);
+    
+    if (g_mkdir_with_parents (dir, 0755) == 0) {
+        key_file = g_key_file_new ();
+        gst_version = gst_version_string ();
+        
+        g_key_file_set_string (key_file, "AudioSink", "Factory", bp_pipeline_audiosinks[index]);
+        g_key_file_set_string (key_file, "AudioSink", "GStreamer", gst_version);
+        
+        data = g_key_file_to_data (key_file, &length, NULL);
+        if (data == NULL || !g_file_set_contents (path, data, length, NULL)) {
+            bp_debug ("Could not write the audio sink cache to %s", path);
+        }
+        
+        g_free (data);
+        g_free (gst_version);
+        g_key_file_free (key_file);
+    }
+    
+    g_free (dir);
+    g_free (path);
+}
+
+static GstElement *
+bp_pipeline_make_audiosink ()
+{
+    GstElement *audiosink = NULL;
+    gint i, cached;
+    
+    // Start with the sink that worked last time, which on most systems
+    // saves a string of failed factory lookups on every construction
+    cached = bp_pipeline_sink_cache_load ();
+    if (cached >= 0) {
+        audiosink = gst_element_factory_make (bp_pipeline_audiosinks[cached], "audiosink");
+    }
+    
+    if (audiosink != NULL) {
+        i = cached;
+    } else {
+        for (i = 0; bp_pipeline_audiosinks[i] != NULL; i++) {
+            if ((audiosink = gst_element_factory_make (bp_pipeline_audiosinks[i], "audiosink")) != NULL) {
+                break;
+            }
+        }
+        
+        if (audiosink == NULL) {
+            return NULL;
+        }
+        
+        bp_pipeline_sink_cache_save (i);
+    }
+    
+    if (strcmp (bp_pipeline_audiosinks[i], "directsoundsink") == 0) {
+        g_object_set (G_OBJECT (audiosink), "volume", 1.0, NULL);
+    }
+    
+    return audiosink;
+}
+
 // ---------------------------------------------------------------------------
 // Internal Functions
 // ---------------------------------------------------------------------------
@@ -180,32 +766,28 @@ _bp_pipeline_construct (BansheePlayer *player)
 {
     GstBus *bus;
     GstPad *teepad;
+    GstPad *queuepad;
     GstElement *audiosink;
     GstElement *audiosinkqueue;
-    GstElement *eq_audioconvert = NULL;
-    GstElement *eq_audioconvert2 = NULL;
+    GstElement *sinkqueue = NULL;
+    GTimer *timer;
     
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
     
     // Playbin is the core element that handles autoplugging (finding the right
-    // source and decoder elements) based on source URI and stream content
+    // source and decoder elements) based on source URI and stream content;
+    // playbin2 additionally lets us preroll the next track for gapless playback
+    #ifdef ENABLE_GAPLESS
+    player->playbin = gst_element_factory_make ("playbin2", "playbin");
+    #else
     player->playbin = gst_element_factory_make ("playbin", "playbin");
+    #endif
     g_return_val_if_fail (player->playbin != NULL, FALSE);
 
-    // Try to find an audio sink, prefer gconf, which typically is set to auto these days,
-    // fall back on auto, which should work on windows, and as a last ditch, try alsa
-    audiosink = gst_element_factory_make ("gconfaudiosink", "audiosink");
-    if (audiosink == NULL) {
-        audiosink = gst_element_factory_make ("directsoundsink", "audiosink");
-        if (audiosink != NULL) {
-            g_object_set (G_OBJECT (audiosink), "volume", 1.0, NULL);
-        } else {
-            audiosink = gst_element_factory_make ("autoaudiosink", "audiosink");
-            if (audiosink == NULL) {
-                audiosink = gst_element_factory_make ("alsasink", "audiosink");
-            }
-        }
-    }
+    timer = g_timer_new ();
+    audiosink = bp_pipeline_make_audiosink ();
+    banshee_record_init_time (BANSHEE_INIT_PHASE_AUDIO_SINK, timer);
+    g_timer_destroy (timer);
     
     g_return_val_if_fail (audiosink != NULL, FALSE);
         
@@ -225,50 +807,82 @@ _bp_pipeline_construct (BansheePlayer *player)
     audiosinkqueue = gst_element_factory_make ("queue", "audiosinkqueue");
     g_return_val_if_fail (audiosinkqueue != NULL, FALSE);
 
-    player->equalizer = _bp_equalizer_new (player);
-    player->preamp = NULL;
-    if (player->equalizer != NULL) {
-        eq_audioconvert = gst_element_factory_make ("audioconvert", "audioconvert");
-        eq_audioconvert2 = gst_element_factory_make ("audioconvert", "audioconvert2");
-        player->preamp = gst_element_factory_make ("volume", "preamp");
-    }
+    // Optionally give the DSP chain a thread of its own, whether or not
+    // there is any DSP in it yet
+    sinkqueue = _bp_threads_sink_queue_new (player);
+    
+    // The equalizer is only linked in once it is used, see banshee-player-equalizer.c
+    _bp_equalizer_pipeline_setup (player, audiosinkqueue, sinkqueue != NULL ? sinkqueue : audiosink);
     
     // Add elements to custom audio sink
     gst_bin_add (GST_BIN (player->audiobin), player->audiotee);
     
-    if (player->equalizer != NULL) {
-        gst_bin_add (GST_BIN (player->audiobin), eq_audioconvert);
-        gst_bin_add (GST_BIN (player->audiobin), eq_audioconvert2);
-        gst_bin_add (GST_BIN (player->audiobin), player->equalizer);
-        gst_bin_add (GST_BIN (player->audiobin), player->preamp);
+    if (sinkqueue != NULL) {
+        gst_bin_add (GST_BIN (player->audiobin), sinkqueue);
     }
     
     gst_bin_add (GST_BIN (player->audiobin), audiosinkqueue);
     gst_bin_add (GST_BIN (player->audiobin), audiosink);
    
+    // The fade volume, if we have one, sits in front of the tee
+    player->fade_volume = _bp_fade_new (player);
+    if (player->fade_volume != NULL) {
+        gst_bin_add (GST_BIN (player->audiobin), player->fade_volume);
+        gst_element_link (player->fade_volume, player->audiotee);
+    }
+    
     // Ghost pad the audio bin so audio is passed from the bin into the tee
     teepad = gst_element_get_pad (player->audiotee, "sink");
-    gst_element_add_pad (player->audiobin, gst_ghost_pad_new ("sink", teepad));
+    if (player->fade_volume != NULL) {
+        GstPad *volumepad = gst_element_get_pad (player->fade_volume, "sink");
+        gst_element_add_pad (player->audiobin, gst_ghost_pad_new ("sink", volumepad));
+        gst_object_unref (volumepad);
+    } else {
+        gst_element_add_pad (player->audiobin, gst_ghost_pad_new ("sink", teepad));
+    }
+    
+    // Watch the stream as it enters the audio bin to track segments and
+    // detect (and measure) gapless track transitions
+    player->segment = gst_segment_new ();
+    gst_segment_init (player->segment, GST_FORMAT_TIME);
+    player->last_buffer_end = GST_CLOCK_TIME_NONE;
+    _bp_state_reset (player);
+    gst_pad_add_event_probe (teepad, G_CALLBACK (bp_pipeline_event_probe), player);
+    gst_pad_add_buffer_probe (teepad, G_CALLBACK (bp_pipeline_buffer_probe), player);
     gst_object_unref (teepad);
 
     // Link the queue and the actual audio sink
-    if (player->equalizer != NULL) {
-        // link in equalizer, preamp and audioconvert.
-        gst_element_link_many (audiosinkqueue, eq_audioconvert, player->preamp, 
-            player->equalizer, eq_audioconvert2, audiosink, NULL);
+    if (sinkqueue != NULL) {
+        gst_element_link_many (audiosinkqueue, sinkqueue, audiosink, NULL);
     } else {
         // link the queue with the real audio sink
         gst_element_link (audiosinkqueue, audiosink);
     }
     
-    _bp_vis_pipeline_setup (player);
+    _bp_profile_pipeline_setup (player, audiosinkqueue, sinkqueue, audiosink);
+    _bp_latency_pipeline_setup (player, audiosink);
+    
+    // The vis branch is normally built the first time visualization is
+    // turned on. Without the tee's alloc-pad property (GStreamer < 0.10.23)
+    // we have to build it now, ahead of src0 below.
+    if (player->vis_data_cb != NULL || player->vis_events_enabled ||
+        !g_object_class_find_property (G_OBJECT_GET_CLASS (player->audiotee), "alloc-pad")) {
+        _bp_vis_pipeline_setup (player);
+    }
+
+    _bp_health_pipeline_setup (player, audiosinkqueue, audiosink);
+    _bp_threads_pipeline_setup (player, audiosinkqueue, sinkqueue);
     
     // Now that our internal audio sink is constructed, tell playbin to use it
     g_object_set (G_OBJECT (player->playbin), "audio-sink", player->audiobin, NULL);
     
     // Connect to the bus to get messages
     bus = gst_pipeline_get_bus (GST_PIPELINE (player->playbin));    
-    gst_bus_add_watch (bus, bp_pipeline_bus_callback, player);
+    bp_pipeline_bus_watch (player, bus);
+    
+    #ifdef ENABLE_GAPLESS
+    g_signal_connect (player->playbin, "about-to-finish", G_CALLBACK (bp_pipeline_about_to_finish), player);
+    #endif
     
     // Now allow specialized pipeline setups
     _bp_cdda_pipeline_setup (player);
@@ -287,12 +901,63 @@ _bp_pipeline_construct (BansheePlayer *player)
     // -- Chris Howie <cdhowie@gmail.com>
 
     // Link the first tee pad to the primary audio sink queue
-    gst_pad_link (gst_element_get_request_pad (player->audiotee, "src0"),
-        gst_element_get_pad (audiosinkqueue, "sink"));
+    teepad = gst_element_get_request_pad (player->audiotee, "src0");
+    queuepad = gst_element_get_static_pad (audiosinkqueue, "sink");
+    gst_pad_link (teepad, queuepad);
+    gst_object_unref (queuepad);
+    
+    // Where we can, pin buffer allocation to this pad so branches added
+    // later (e.g. the vis branch) never take it over
+    if (g_object_class_find_property (G_OBJECT_GET_CLASS (player->audiotee), "alloc-pad")) {
+        g_object_set (player->audiotee, "alloc-pad", teepad, NULL);
+    }
+    
+    gst_object_unref (teepad);
 
     return TRUE;
 }
 
+void
+_bp_pipeline_bus_thread_shutdown (BansheePlayer *player)
+{
+    GSList *node;
+    GSource *source;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->bus_thread != NULL) {
+        // Quit from within the loop; quitting from here could come before
+        // g_main_loop_run has even started, and the join would never return
+        source = g_idle_source_new ();
+        g_source_set_callback (source, (GSourceFunc)bp_pipeline_bus_thread_quit, player, NULL);
+        g_source_attach (source, player->bus_context);
+        g_source_unref (source);
+        
+        g_thread_join (player->bus_thread);
+        player->bus_thread = NULL;
+        
+        g_main_loop_unref (player->bus_loop);
+        g_main_context_unref (player->bus_context);
+        player->bus_loop = NULL;
+        player->bus_context = NULL;
+    }
+    
+    // Drop anything that never got handled or dispatched to the host
+    g_mutex_lock (player->mutex);
+    for (node = player->bus_marshalled; node != NULL; node = node->next) {
+        g_source_destroy (((BpMarshalledMessage *)node->data)->source);
+    }
+    
+    g_slist_free (player->bus_marshalled);
+    player->bus_marshalled = NULL;
+    g_mutex_unlock (player->mutex);
+    
+    if (player->bus_callback_context != NULL) {
+        g_main_context_unref (player->bus_callback_context);
+        player->bus_callback_context = NULL;
+    }
+}
+
 void
 _bp_pipeline_destroy (BansheePlayer *player)
 {
@@ -302,13 +967,78 @@ _bp_pipeline_destroy (BansheePlayer *player)
         return;
     }
     
+    _bp_seek_reset (player);
+    _bp_suspend_reset (player);
+    _bp_health_pipeline_destroy (player);
+    _bp_profile_pipeline_destroy (player);
+    
+    if (player->bus_watch != NULL) {
+        g_source_destroy (player->bus_watch);
+        g_source_unref (player->bus_watch);
+        player->bus_watch = NULL;
+    }
+    
     if (GST_IS_ELEMENT (player->playbin)) {
         player->target_state = GST_STATE_NULL;
         gst_element_set_state (player->playbin, GST_STATE_NULL);
+    }
+    
+    // Only once nothing streams through the tee any more
+    _bp_tee_pipeline_destroy (player);
+    
+    if (GST_IS_ELEMENT (player->playbin)) {
         gst_object_unref (GST_OBJECT (player->playbin));
     }
     
     _bp_vis_pipeline_destroy (player);
+    _bp_equalizer_pipeline_destroy (player);
+    _bp_fade_destroy (player);
+    player->fade_volume = NULL;
+    _bp_state_destroy (player);
+    
+    if (player->segment != NULL) {
+        gst_segment_free (player->segment);
+        player->segment = NULL;
+    }
     
     player->playbin = NULL;
+    
+    // The next pipeline starts its transitions from scratch
+    player->reported_old_state = GST_STATE_VOID_PENDING;
+    player->reported_new_state = GST_STATE_VOID_PENDING;
+    player->reported_pending_state = GST_STATE_VOID_PENDING;
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE gboolean
+bp_set_bus_thread_enabled (BansheePlayer *player, gboolean enabled, GMainContext *callback_context)
+{
+    // With a dedicated bus thread, EOS, buffering and error handling no
+    // longer queue up behind the application main loop. Messages are
+    // marshalled to callback_context, or the default main context if it
+    // is NULL, where our own handling (error teardown, buffering, the
+    // missing elements installer) runs first and the host callbacks right
+    // after it. This must be set before the pipeline is constructed.
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    if (player->playbin != NULL || player->bus_thread != NULL) {
+        g_warning ("The bus dispatch mode must be set before the pipeline is constructed");
+        return FALSE;
+    }
+    
+    player->bus_thread_enabled = enabled;
+    
+    if (player->bus_callback_context != NULL) {
+        g_main_context_unref (player->bus_callback_context);
+    }
+    
+    player->bus_callback_context = enabled && callback_context != NULL
+        ? g_main_context_ref (callback_context)
+        : NULL;
+    
+    return TRUE;
 }
@@ -33,5 +33,6 @@
 
 gboolean  _bp_pipeline_construct (BansheePlayer *player);
 void      _bp_pipeline_destroy   (BansheePlayer *player);
+void      _bp_pipeline_bus_thread_shutdown (BansheePlayer *player);
 
 #endif /* _BANSHEE_PLAYER_PIPELINE_H */
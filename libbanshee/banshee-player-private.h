@@ -36,8 +36,15 @@
 #include <string.h>
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
-#include <gdk/gdk.h>
+#ifdef ENABLE_HEADLESS
+// Without GDK, windows are only ever passed through as opaque handles
+typedef struct _GdkWindow GdkWindow;
+#else
+#  include <gdk/gdk.h>
+#endif
 #include <gst/fft/gstfftf32.h>
+#include <gst/controller/gstcontroller.h>
+#include <gst/controller/gstinterpolationcontrolsource.h>
 
 #ifdef HAVE_GST_PBUTILS
 #  include <gst/pbutils/pbutils.h>
@@ -61,6 +68,12 @@
 #define IS_BANSHEE_PLAYER(e) (e != NULL)
 #define SET_CALLBACK(cb_name) { if(player != NULL) { player->cb_name = cb; } }
 
+// Serializes everything that changes the pipeline's state or tears it
+// down: the public bp_* calls, the async worker and the bus handler. It
+// is taken before, never while holding, player->mutex
+#define bp_pipeline_lock(player)   g_static_rec_mutex_lock (&(player)->pipeline_mutex)
+#define bp_pipeline_unlock(player) g_static_rec_mutex_unlock (&(player)->pipeline_mutex)
+
 #ifdef WIN32
 // TODO Windows doesn't like the ... varargs
 #define bp_debug(x)
@@ -75,28 +88,268 @@ typedef void (* BansheePlayerErrorCallback)        (BansheePlayer *player, GQuar
                                                     const gchar *error, const gchar *debug);
 typedef void (* BansheePlayerStateChangedCallback) (BansheePlayer *player, GstState old_state, 
                                                     GstState new_state, GstState pending_state);
+typedef void (* BansheePlayerElementStateChangedCallback) (BansheePlayer *player, const gchar *element,
+                                                    GstState old_state, GstState new_state, GstState pending_state);
 typedef void (* BansheePlayerIterateCallback)      (BansheePlayer *player);
 typedef void (* BansheePlayerBufferingCallback)    (BansheePlayer *player, gint buffering_progress);
 typedef void (* BansheePlayerTagFoundCallback)     (BansheePlayer *player, const gchar *tag, const GValue *value);
+typedef enum {
+    BP_TAG_TYPE_NONE = 0,
+    BP_TAG_TYPE_INT,
+    BP_TAG_TYPE_UINT,
+    BP_TAG_TYPE_INT64,
+    BP_TAG_TYPE_UINT64,
+    BP_TAG_TYPE_BOOLEAN,
+    BP_TAG_TYPE_DOUBLE,
+    BP_TAG_TYPE_STRING,
+    BP_TAG_TYPE_DATE        // int_value is the julian day
+} BpTagType;
+
+// Flat tag record for batched delivery; the 8 byte members come first so
+// the layout is identical for a sequential managed struct on 32 and 64 bit.
+// name is interned and stays valid, string_value only for the callback.
+typedef struct {
+    gint64 int_value;
+    gdouble double_value;
+    const gchar *name;
+    const gchar *string_value;
+    GQuark quark;
+    BpTagType type;
+} BpTag;
+
+typedef void (* BansheePlayerTagsFoundCallback)    (BansheePlayer *player, const BpTag *tags, gint count);
 typedef void (* BansheePlayerVisDataCallback)      (BansheePlayer *player, gint channels, gint samples, gfloat *data, gint bands, gfloat *spectrum);
 typedef GstElement * (* BansheePlayerVideoPipelineSetupCallback) (BansheePlayer *player, GstBus *bus);
 
+typedef enum {
+    BP_ASYNC_OPEN,
+    BP_ASYNC_PLAY,
+    BP_ASYNC_PAUSE,
+    BP_ASYNC_STOP,
+    BP_ASYNC_SEEK,
+    BP_ASYNC_QUIT
+} BpAsyncOperation;
+
+typedef void (* BansheePlayerAsyncDoneCallback)    (BansheePlayer *player, BpAsyncOperation operation,
+                                                    gboolean success, guint64 latency_us);
+
+// 0.10 has no snap flags; a key unit seek lands on the keyframe
+// the demuxer picks, which is normally the preceding one
+typedef enum {
+    BP_SEEK_MODE_DEFAULT = 0,
+    BP_SEEK_MODE_KEY_UNIT,
+    BP_SEEK_MODE_ACCURATE
+} BpSeekMode;
+
+typedef void (* BansheePlayerSeekDoneCallback)     (BansheePlayer *player, guint64 position_ms, 
+                                                    guint64 latency_us);
+
+typedef enum {
+    BP_LATENCY_STARTUP = 0,  // bp_open or a cold bp_play to the first buffer at the sink
+    BP_LATENCY_SEEK,         // bp_set_position to the first buffer after its flush
+    BP_LATENCY_UNPAUSE,      // bp_play from PAUSED to the next buffer at the sink
+    BP_LATENCY_RESUME,       // bp_resume to the first buffer after its restoring seek
+    BP_LATENCY_KIND_COUNT
+} BpLatencyKind;
+
+#define BP_LATENCY_HISTOGRAM_SIZE 16
+
+typedef struct {
+    guint64 count;
+    guint64 last_us;
+    guint64 min_us;
+    guint64 max_us;
+    guint32 histogram[BP_LATENCY_HISTOGRAM_SIZE];
+} BpLatencyStats;
+
+typedef struct {
+    guint64 queue_level_time;
+    guint64 vis_queue_level_time;
+    guint queue_level_bytes;
+    guint queue_level_buffers;
+    guint vis_queue_level_buffers;
+    guint queue_underruns;
+    guint queue_overruns;
+    guint vis_queue_drops;
+    guint late_buffers;
+    guint buffers;
+} BpHealthStats;
+
+typedef void (* BansheePlayerHealthCallback)       (BansheePlayer *player, const BpHealthStats *stats);
+
+typedef enum {
+    BP_LATENCY_PROFILE_LOW = 0,
+    BP_LATENCY_PROFILE_DEFAULT = 1,
+    BP_LATENCY_PROFILE_POWER_SAVER = 2
+} BpLatencyProfile;
+
+typedef enum {
+    BP_THREAD_TOPOLOGY_DEFAULT = 0,  // decode | DSP and sink
+    BP_THREAD_TOPOLOGY_SPLIT         // decode | DSP | sink
+} BpThreadTopology;
+
+typedef enum {
+    BP_THREAD_STAGE_DECODE = 0,
+    BP_THREAD_STAGE_DSP,
+    BP_THREAD_STAGE_SINK,
+    BP_THREAD_STAGE_VIS,
+    BP_THREAD_STAGE_ANALYSIS,
+    BP_THREAD_STAGE_COUNT
+} BpThreadStage;
+
+typedef struct {
+    guint64 cpu_time;   // nsec of thread CPU time spent in the stage
+    guint64 buffers;
+    guint64 threads;    // distinct threads seen running the stage
+} BpStageStats;
+
+typedef struct {
+    BpStageStats stats;
+    GThread *thread;
+    guint64 last_cpu_time;
+    volatile gint sequence;     // odd while stats is being written
+} BpStageAccount;
+
+// Gapless callbacks; about-to-finish is raised from a streaming thread
+typedef void (* BansheePlayerAboutToFinishCallback)     (BansheePlayer *player);
+typedef void (* BansheePlayerNextTrackStartingCallback) (BansheePlayer *player);
+
+typedef struct {
+    guint64 position;
+    guint64 duration;
+    gboolean can_seek;
+    gdouble rate;
+    GstState state;
+    GstClockTime base_time;
+    GstClockTime clock_time;
+    gboolean suspended;
+} BpStateSnapshot;
+
+typedef enum {
+    BP_EVENT_NONE = 0,
+    BP_EVENT_EOS,
+    BP_EVENT_ERROR,
+    BP_EVENT_STATE_CHANGED,
+    BP_EVENT_BUFFERING,
+    BP_EVENT_TAG,
+    BP_EVENT_ITERATE,
+    BP_EVENT_NEXT_TRACK_STARTING,
+    BP_EVENT_ASYNC_DONE,
+    BP_EVENT_VIS_DATA,
+    BP_EVENT_SEEK_DONE,
+    BP_EVENT_HEALTH,
+    BP_EVENT_TYPE_COUNT
+} BpEventType;
+
+// One queued player event, as returned by bp_poll_events. The meaning of
+// the generic members depends on type:
+//   ERROR:          arg0 domain, arg1 code, string_value message, detail debug
+//   STATE_CHANGED:  arg0 old, arg1 new, arg2 pending
+//   BUFFERING:      arg0 percent
+//   TAG:            name, arg0 BpTagType, arg1 quark, and the matching value
+//   ASYNC_DONE:     arg0 operation, arg1 success, int_value latency in usec
+//   VIS_DATA:       arg0 channels, arg1 samples, arg2 bands, samples, spectrum
+//   SEEK_DONE:      int_value position in msec, double_value latency in usec
+//   HEALTH:         arg0 queue underruns, arg1 queue overruns, arg2 vis queue drops,
+//                   arg3 late buffers, int_value queue level in nsec
+// Strings and buffers belong to the player and stay valid until the next poll.
+typedef struct {
+    gint64 timestamp;
+    gint64 int_value;
+    gdouble double_value;
+    const gchar *name;
+    gchar *string_value;
+    gchar *detail;
+    gfloat *samples;
+    gfloat *spectrum;
+    BpEventType type;
+    gint arg0;
+    gint arg1;
+    gint arg2;
+    gint arg3;
+} BpEvent;
+
+typedef struct {
+    BpEvent *slots;
+    guint mask;
+    volatile gint head;
+    volatile gint tail;
+    guint held;
+} BpEventRing;
+
 typedef enum {
     BP_VIDEO_DISPLAY_CONTEXT_UNSUPPORTED = 0,
     BP_VIDEO_DISPLAY_CONTEXT_GDK_WINDOW = 1,
     BP_VIDEO_DISPLAY_CONTEXT_CUSTOM = 2
 } BpVideoDisplayContextType;
 
+typedef struct {
+    BansheePlayer *player;
+    GstMessage *message;
+    GSource *source;
+} BpMarshalledMessage;
+
+typedef struct {
+    gfloat *pcm;
+    gint size;
+    gint channels;
+    gint samples;
+    gint rate;
+    gboolean discont;
+} BpVisSlice;
+
+typedef enum {
+    BP_VIS_BAND_SCALE_LINEAR = 0,
+    BP_VIS_BAND_SCALE_LOG,
+    BP_VIS_BAND_SCALE_BARK
+} BpVisBandScale;
+
+typedef struct {
+    gint fft_size;          // samples per FFT; spectrum has fft_size / 2 bins
+    gint hop_size;          // samples per channel between frames
+    gint bands;             // 0 hands over every bin
+    BpVisBandScale scale;
+    gboolean include_pcm;
+    gboolean decimate;      // filter hi-res streams down towards 44.1 kHz
+    gboolean fast_fft;      // round FFT sizes up to ones kiss_fft does quickly
+} BpVisConfig;
+
+typedef enum {
+    BP_SUSPEND_NONE = 0,
+    BP_SUSPEND_SUSPENDED,
+    BP_SUSPEND_PREROLLING,
+    BP_SUSPEND_SEEKING
+} BpSuspendPhase;
+
+typedef struct {
+    BansheePlayer *player;
+    GstElement *element;
+    GstPad *tee_pad;
+    gulong probe_id;
+    gulong drop_probe_id;
+    gboolean attached;
+    gboolean removed;
+    gboolean detaching;     // tee_pad is blocked, or about to be, for the unlink
+    gboolean unlinked;      // tee_pad is unlinked, waiting to be released
+} BpTeeBranch;
+
 struct BansheePlayer {
     // Player Callbacks
     BansheePlayerEosCallback eos_cb;
     BansheePlayerErrorCallback error_cb;
     BansheePlayerStateChangedCallback state_changed_cb;
+    BansheePlayerElementStateChangedCallback element_state_changed_cb;
     BansheePlayerIterateCallback iterate_cb;
     BansheePlayerBufferingCallback buffering_cb;
     BansheePlayerTagFoundCallback tag_found_cb;
+    BansheePlayerTagsFoundCallback tags_found_cb;
     BansheePlayerVisDataCallback vis_data_cb;
     BansheePlayerVideoPipelineSetupCallback video_pipeline_setup_cb;
+    BansheePlayerAboutToFinishCallback about_to_finish_cb;
+    BansheePlayerNextTrackStartingCallback next_track_starting_cb;
+    BansheePlayerAsyncDoneCallback async_done_cb;
+    BansheePlayerSeekDoneCallback seek_done_cb;
+    BansheePlayerHealthCallback health_cb;
 
     // Pipeline Elements
     GstElement *playbin;
@@ -104,15 +357,145 @@ struct BansheePlayer {
     GstElement *audiobin;
     GstElement *equalizer;
     GstElement *preamp;
+    GstElement *equalizer_audioconvert;
+    GstElement *equalizer_audioconvert2;
+    GstElement *equalizer_upstream;
+    GstElement *equalizer_downstream;
+    gboolean equalizer_linked;      // the chain is in the pipeline
+    gboolean equalizer_wanted;      // it should be; guarded by mutex
+    gboolean equalizer_blocking;
+    
+    // Branches hanging off audiotee, linked and unlinked at runtime
+    GSList *tee_branches;
+    GMutex *tee_mutex;
+    GSource *tee_source;
     gint equalizer_status;
     gdouble current_volume;
     
     // Pipeline/Playback State
     GMutex *mutex;
+    GStaticRecMutex pipeline_mutex;
     GstState target_state;
     guint iterate_timeout_id;
+    guint iterate_interval;
+    guint64 iterate_wakeups;
     gboolean buffering;
     gchar *cdda_device;
+    GstSegment *segment;
+    
+    // Seek scheduling
+    BpSeekMode seek_mode;
+    gboolean seek_in_flight;
+    gboolean seek_pending;
+    guint64 seek_target;
+    guint64 seek_pending_target;
+    GstClockTime seek_issued;
+    guint64 seeks_coalesced;
+    
+    // Latency instrumentation, guarded by mutex
+    GstClockTime latency_armed[BP_LATENCY_KIND_COUNT];
+    gboolean latency_seek_flushed;
+    BpLatencyStats latency_stats[BP_LATENCY_KIND_COUNT];
+    
+    // Streaming thread layout and per stage CPU accounting
+    BpThreadTopology thread_topology;
+    BpStageAccount stage_accounts[BP_THREAD_STAGE_COUNT];
+    
+    // Output latency profile
+    BpLatencyProfile latency_profile;
+    GstElement *profile_queue;
+    GstElement *profile_sink_queue;
+    GstElement *profile_sink;
+    
+    // Pipeline health; counters are bumped atomically from streaming threads
+    GstElement *health_queue;
+    GstElement *health_vis_queue;
+    gulong health_vis_queue_handler;
+    GstSegment health_segment;
+    gboolean health_flushing;
+    GstClockTime health_running_time;   // of the newest buffer at the sink
+    volatile gint health_sequence;      // odd while health_running_time is written
+    GstClockTime health_judged_time;
+    volatile gint health_queue_underruns;
+    volatile gint health_queue_overruns;
+    volatile gint health_vis_queue_drops;
+    volatile gint health_late_buffers;
+    volatile gint health_buffers;
+    guint health_interval;
+    guint health_timeout_id;
+    
+    // Polled event delivery
+    gboolean events_enabled;
+    gboolean vis_events_enabled;
+    GMutex *events_mutex;
+    BpEventRing *event_ring;
+    BpEventRing *vis_event_ring;
+    volatile guint event_counts[BP_EVENT_TYPE_COUNT];     // wrap around at 2^32
+    guint64 events_dropped;
+    volatile gint vis_events_dropped;
+    
+    // Batched tag delivery
+    GstTagList *tag_cache;
+    GArray *tag_batch;
+    volatile gint tag_cache_reset;
+    guint64 tags_suppressed;
+    
+    // Last top level transition reported to the host
+    GstState reported_old_state;
+    GstState reported_new_state;
+    GstState reported_pending_state;
+    
+    // Bus Dispatch State
+    GSource *bus_watch;
+    gboolean bus_thread_enabled;
+    GThread *bus_thread;
+    GMainContext *bus_context;
+    GMainLoop *bus_loop;
+    GMainContext *bus_callback_context;
+    GSList *bus_marshalled;
+    
+    // Asynchronous transitions worker
+    GThread *async_thread;
+    GAsyncQueue *async_queue;
+    GSList *async_pending;
+    
+    // State Snapshot; see banshee-player-state.c
+    volatile gint state_sequence;
+    GstState state_current;
+    gint64 state_segment_time;
+    gint64 state_segment_accum;
+    gdouble state_segment_rate;
+    GstClockTime state_running_time;
+    GstClockTime state_base_time;
+    GstClockTime state_duration;
+    gboolean state_can_seek;
+    GstClock *state_clock;
+    GSList *state_retired_clocks;
+    volatile gint state_readers;    // snapshots in progress, see _bp_state_destroy
+    gboolean state_suspended;
+    guint64 state_suspend_position;
+    guint64 state_suspend_duration;
+    
+    // Suspend State
+    BpSuspendPhase suspend_phase;
+    GstState suspend_state;
+    gchar *suspend_uri;
+    guint64 suspend_position;
+    guint64 suspend_duration;
+    
+    // Gapless State
+    gchar *next_uri;
+    gint next_track_pending;
+    volatile gint measure_transition_gap;
+    GstClockTime last_buffer_end;
+    GstClockTimeDiff transition_gap;    // under mutex
+    
+    // Fade State
+    GstElement *fade_volume;
+    GstController *fade_controller;
+    GstInterpolationControlSource *fade_control_source;
+    guint fade_duration;
+    gboolean fade_in;
     
     // Video State
     BpVideoDisplayContextType video_display_context_type;
@@ -122,13 +505,45 @@ struct BansheePlayer {
     #endif
        
     // Visualization State
-    GstElement *vis_resampler;
+    GstElement *vis_bin;
     GstAdapter *vis_buffer;
     gboolean vis_enabled;
     gboolean vis_thawing;
     GstFFTF32 *vis_fft;
     GstFFTF32Complex *vis_fft_buffer;
     gfloat *vis_fft_sample_buffer;
+    gfloat *vis_spectrum;
+    gfloat *vis_window;
+    gfloat *vis_deinterlaced;
+    gint vis_deinterlaced_size;
+    volatile gint vis_slices;
+    volatile gint vis_slices_dropped;
+    volatile gint vis_allocations;
+    gboolean vis_discont;
+    BpVisSlice *vis_ring;
+    volatile gint vis_ring_head;
+    volatile gint vis_ring_tail;
+    GThread *vis_worker;
+    GMutex *vis_worker_mutex;
+    GCond *vis_worker_cond;
+    gboolean vis_worker_quit;
+    volatile gint vis_worker_idle;
+    BpVisConfig vis_config;         // requested, under mutex
+    volatile gint vis_config_serial;
+    volatile gint vis_hop_size;     // read by the streaming thread
+    volatile gint vis_decimate;
+    BpVisConfig vis_applied;        // in use by the worker
+    gint vis_applied_serial;
+    gint vis_rate;                  // stream rate the analysis is sized for
+    gint vis_decimation;
+    gint vis_fft_size;              // at the decimated rate
+    gint vis_hop;
+    gint *vis_band_edges;
+    gfloat *vis_bands;
+    gfloat *vis_mono;
+    gfloat *vis_decimate_history;   // channels and the mono downmix
+    gfloat *vis_decimate_scratch;
+    gint vis_decimate_channels;
     
     // Plugin Installer State
     GdkWindow *window;
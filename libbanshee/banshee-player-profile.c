@@ -0,0 +1,202 @@
+//
+// banshee-player-profile.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "banshee-player-profile.h"
+
+typedef struct {
+    gint64 buffer_time;      // usec, sink ring buffer size
+    gint64 latency_time;     // usec, sink ring buffer segment size
+    guint queue_buffers;
+    guint queue_bytes;
+    guint64 queue_time;      // nsec
+    guint64 sink_queue_time; // nsec, split topology sinkqueue only
+} BpLatencyProfileSettings;
+
+// DEFAULT is what GStreamer 0.10 itself uses for baseaudiosink and queue.
+// LOW keeps pause, volume and EQ changes within a few tens of ms of the
+// speakers; POWER_SAVER lets the sink and the decoder sleep for longer
+// between wakeups at the cost of sluggish controls. The sinkqueue of the
+// split thread topology only decouples the sink from the DSP thread, so
+// it always holds a fraction of what audiosinkqueue does.
+static const BpLatencyProfileSettings bp_profile_settings[] = {
+    /* LOW */         {   40000,  10000,   0,        0,  50 * GST_MSECOND,  20 * GST_MSECOND },
+    /* DEFAULT */     {  200000,  10000, 200, 10485760,       GST_SECOND, 100 * GST_MSECOND },
+    /* POWER_SAVER */ { 1000000, 100000,   0,        0,   3 * GST_SECOND, 500 * GST_MSECOND }
+};
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void bp_profile_element_added (GstBin *bin, GstElement *element, BansheePlayer *player);
+
+static void
+bp_profile_apply_sink (BansheePlayer *player, GstElement *element)
+{
+    const BpLatencyProfileSettings *settings = &bp_profile_settings[player->latency_profile];
+    
+    // Auto and gconf sinks are bins which only create the real sink
+    // when they start, so follow them down as children are added
+    if (GST_IS_BIN (element)) {
+        GstIterator *iter;
+        gpointer child;
+        gboolean done = FALSE;
+        
+        if (!g_signal_handler_find (element, G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA, 
+            0, 0, NULL, bp_profile_element_added, player)) {
+            g_signal_connect (element, "element-added", G_CALLBACK (bp_profile_element_added), player);
+        }
+        
+        iter = gst_bin_iterate_elements (GST_BIN (element));
+        while (!done) {
+            switch (gst_iterator_next (iter, &child)) {
+                case GST_ITERATOR_OK:
+                    bp_profile_apply_sink (player, GST_ELEMENT (child));
+                    gst_object_unref (child);
+                    break;
+                case GST_ITERATOR_RESYNC:
+                    gst_iterator_resync (iter);
+                    break;
+                default:
+                    done = TRUE;
+                    break;
+            }
+        }
+        gst_iterator_free (iter);
+        return;
+    }
+    
+    // Takes effect the next time the sink acquires its ring buffer
+    if (g_object_class_find_property (G_OBJECT_GET_CLASS (element), "buffer-time") &&
+        g_object_class_find_property (G_OBJECT_GET_CLASS (element), "latency-time")) {
+        bp_debug ("Latency profile %d on %s", player->latency_profile, GST_ELEMENT_NAME (element));
+        g_object_set (element, 
+            "buffer-time", settings->buffer_time,
+            "latency-time", settings->latency_time,
+            NULL);
+    }
+}
+
+static void
+bp_profile_element_added (GstBin *bin, GstElement *element, BansheePlayer *player)
+{
+    bp_profile_apply_sink (player, element);
+}
+
+static void
+bp_profile_apply_sink_queue (BansheePlayer *player)
+{
+    const BpLatencyProfileSettings *settings = &bp_profile_settings[player->latency_profile];
+    
+    if (player->profile_sink_queue != NULL) {
+        g_object_set (player->profile_sink_queue,
+            "max-size-buffers", 0,
+            "max-size-bytes", 0,
+            "max-size-time", settings->sink_queue_time,
+            NULL);
+    }
+}
+
+static void
+bp_profile_apply (BansheePlayer *player)
+{
+    const BpLatencyProfileSettings *settings = &bp_profile_settings[player->latency_profile];
+    
+    if (player->profile_queue != NULL) {
+        g_object_set (player->profile_queue,
+            "max-size-buffers", settings->queue_buffers,
+            "max-size-bytes", settings->queue_bytes,
+            "max-size-time", settings->queue_time,
+            NULL);
+    }
+    
+    bp_profile_apply_sink_queue (player);
+    
+    if (player->profile_sink != NULL) {
+        bp_profile_apply_sink (player, player->profile_sink);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void
+_bp_profile_pipeline_setup (BansheePlayer *player, GstElement *audiosinkqueue, 
+    GstElement *sinkqueue, GstElement *audiosink)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    player->profile_queue = audiosinkqueue;
+    player->profile_sink_queue = sinkqueue;
+    player->profile_sink = audiosink;
+    
+    // Leave the elements exactly as they come unless asked otherwise; the
+    // sinkqueue is ours alone and has no stock limits worth keeping
+    if (player->latency_profile != BP_LATENCY_PROFILE_DEFAULT) {
+        bp_profile_apply (player);
+    } else {
+        bp_profile_apply_sink_queue (player);
+    }
+}
+
+void
+_bp_profile_pipeline_destroy (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    player->profile_queue = NULL;
+    player->profile_sink_queue = NULL;
+    player->profile_sink = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE gboolean
+bp_set_latency_profile (BansheePlayer *player, BpLatencyProfile profile)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    g_return_val_if_fail (profile >= BP_LATENCY_PROFILE_LOW && profile <= BP_LATENCY_PROFILE_POWER_SAVER, FALSE);
+    
+    if (player->latency_profile == profile) {
+        return TRUE;
+    }
+    
+    player->latency_profile = profile;
+    bp_profile_apply (player);
+    return TRUE;
+}
+
+P_INVOKE BpLatencyProfile
+bp_get_latency_profile (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), BP_LATENCY_PROFILE_DEFAULT);
+    return player->latency_profile;
+}
@@ -83,22 +83,25 @@ bp_replaygain_update_pipeline (BansheePlayer *player,
 // ---------------------------------------------------------------------------
 
 void
-_bp_replaygain_process_tag (BansheePlayer *player, const gchar *tag_name, const GValue *value)
+_bp_replaygain_process_tag_list (BansheePlayer *player, const GstTagList *tag_list)
 {
-    if (strcmp (tag_name, GST_TAG_ALBUM_GAIN) == 0) {
-        player->album_gain = g_value_get_double (value);
-    } else if (strcmp (tag_name, GST_TAG_ALBUM_PEAK) == 0) {
-        player->album_peak = g_value_get_double (value);
-    } else if (strcmp (tag_name, GST_TAG_TRACK_GAIN) == 0) {
-        player->track_gain = g_value_get_double (value);
-    } else if (strcmp (tag_name, GST_TAG_TRACK_PEAK) == 0) {
-        player->track_peak = g_value_get_double (value);
-    }
+    // Look the four gain tags up directly rather than matching
+    // every tag in the list against each of them
+    gst_tag_list_get_double (tag_list, GST_TAG_ALBUM_GAIN, &player->album_gain);
+    gst_tag_list_get_double (tag_list, GST_TAG_ALBUM_PEAK, &player->album_peak);
+    gst_tag_list_get_double (tag_list, GST_TAG_TRACK_GAIN, &player->track_gain);
+    gst_tag_list_get_double (tag_list, GST_TAG_TRACK_PEAK, &player->track_peak);
 }
 
 void 
 _bp_replaygain_handle_state_changed (BansheePlayer *player, GstState old, GstState new, GstState pending)
 {
+    // Going to NULL for bp_suspend is not the end of the track, so the
+    // history and the gains read from its tags stay as they are
+    if (player->suspend_phase != BP_SUSPEND_NONE) {
+        return;
+    }
+    
     if (old == GST_STATE_READY && new == GST_STATE_NULL && 
         pending == GST_STATE_VOID_PENDING && player->volume_scale_history_shift) {
         
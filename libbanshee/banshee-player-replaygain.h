@@ -31,7 +31,7 @@
 
 #include "banshee-player-private.h"
 
-void _bp_replaygain_process_tag          (BansheePlayer *player, const gchar *tag_name, const GValue *value);
+void _bp_replaygain_process_tag_list     (BansheePlayer *player, const GstTagList *tag_list);
 void _bp_replaygain_handle_state_changed (BansheePlayer *player, GstState old, GstState new, GstState pending);
 void _bp_replaygain_update_volume        (BansheePlayer *player);
 
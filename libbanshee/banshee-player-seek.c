@@ -0,0 +1,213 @@
+//
+// banshee-player-seek.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "banshee-player-seek.h"
+#include "banshee-player-state.h"
+
+// A seek still unsettled after this long is assumed lost (e.g. the
+// pipeline errored out under it) and no longer holds back new seeks
+#define BP_SEEK_STALE_TIMEOUT (2 * GST_SECOND)
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static gboolean
+bp_seek_issue (BansheePlayer *player, guint64 time_ms)
+{
+    GstSeekFlags flags = GST_SEEK_FLAG_FLUSH;
+    
+    switch (player->seek_mode) {
+        case BP_SEEK_MODE_KEY_UNIT: flags |= GST_SEEK_FLAG_KEY_UNIT; break;
+        case BP_SEEK_MODE_ACCURATE: flags |= GST_SEEK_FLAG_ACCURATE; break;
+        default: break;
+    }
+    
+    return player->playbin != NULL && gst_element_seek (player->playbin, 1.0, 
+        GST_FORMAT_TIME, flags,
+        GST_SEEK_TYPE_SET, time_ms * GST_MSECOND, 
+        GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE);
+}
+
+static void
+bp_seek_post_done (BansheePlayer *player, guint64 time_ms, GstClockTime latency)
+{
+    GstBus *bus;
+    
+    if (player->playbin == NULL) {
+        return;
+    }
+    
+    // Host notification goes through the bus like everything else so
+    // it is delivered from wherever the host takes its callbacks
+    bus = gst_element_get_bus (player->playbin);
+    gst_bus_post (bus, gst_message_new_application (GST_OBJECT (player->playbin), 
+        gst_structure_new ("seek-done", 
+            "position", G_TYPE_UINT64, time_ms,
+            "latency", G_TYPE_UINT64, (guint64)(latency / GST_USECOND),
+            NULL)));
+    gst_object_unref (bus);
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+gboolean
+_bp_seek_schedule (BansheePlayer *player, guint64 time_ms)
+{
+    BpStateSnapshot snapshot;
+    GstClockTime now;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    if (player->playbin == NULL) {
+        return FALSE;
+    }
+    
+    _bp_state_get_snapshot (player, &snapshot);
+    now = gst_util_get_timestamp ();
+    
+    g_mutex_lock (player->mutex);
+    
+    // While a flushing seek is still prerolling, only remember the
+    // newest target; it is issued as soon as the current one settles
+    if (player->seek_in_flight && now - player->seek_issued < BP_SEEK_STALE_TIMEOUT) {
+        if (player->seek_pending) {
+            player->seeks_coalesced++;
+        }
+        
+        player->seek_pending = TRUE;
+        player->seek_pending_target = time_ms;
+        g_mutex_unlock (player->mutex);
+        return TRUE;
+    }
+    
+    // Seeks below PAUSED never complete asynchronously, so don't track them
+    player->seek_in_flight = snapshot.state >= GST_STATE_PAUSED;
+    player->seek_pending = FALSE;
+    player->seek_target = time_ms;
+    player->seek_issued = now;
+    
+    g_mutex_unlock (player->mutex);
+    
+    // Never seek with the mutex held, the flush takes it from the
+    // streaming thread on its way through the pad probes
+    if (!bp_seek_issue (player, time_ms)) {
+        g_mutex_lock (player->mutex);
+        player->seek_in_flight = FALSE;
+        g_mutex_unlock (player->mutex);
+        
+        g_warning ("Could not seek in stream");
+        return FALSE;
+    }
+    
+    return TRUE;
+}
+
+void
+_bp_seek_reset (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    g_mutex_lock (player->mutex);
+    player->seek_in_flight = FALSE;
+    player->seek_pending = FALSE;
+    g_mutex_unlock (player->mutex);
+}
+
+void
+_bp_seek_handle_async_done (BansheePlayer *player)
+{
+    GstClockTime now = gst_util_get_timestamp ();
+    GstClockTime latency;
+    guint64 target;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    g_mutex_lock (player->mutex);
+    
+    if (!player->seek_in_flight) {
+        g_mutex_unlock (player->mutex);
+        return;
+    }
+    
+    latency = now - player->seek_issued;
+    target = player->seek_target;
+    
+    if (!player->seek_pending) {
+        player->seek_in_flight = FALSE;
+        g_mutex_unlock (player->mutex);
+        
+        bp_seek_post_done (player, target, latency);
+        return;
+    }
+    
+    // Superseded while it was in flight; chase the latest target
+    target = player->seek_target = player->seek_pending_target;
+    player->seek_pending = FALSE;
+    player->seek_issued = now;
+    
+    g_mutex_unlock (player->mutex);
+    
+    if (!bp_seek_issue (player, target)) {
+        g_warning ("Could not seek in stream");
+        _bp_seek_reset (player);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE void
+bp_set_seek_mode (BansheePlayer *player, BpSeekMode mode)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    player->seek_mode = mode;
+}
+
+P_INVOKE BpSeekMode
+bp_get_seek_mode (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), BP_SEEK_MODE_DEFAULT);
+    return player->seek_mode;
+}
+
+P_INVOKE void
+bp_set_seek_done_callback (BansheePlayer *player, BansheePlayerSeekDoneCallback cb)
+{
+    SET_CALLBACK (seek_done_cb);
+}
+
+P_INVOKE guint64
+bp_get_seeks_coalesced (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
+    return player->seeks_coalesced;
+}
@@ -0,0 +1,324 @@
+//
+// banshee-player-state.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "banshee-player-state.h"
+
+// The state block is written by the streaming thread (segments, flushes)
+// and the bus handler (state, clock, duration), which serialize on the
+// player mutex. Readers never lock: they retry if the sequence counter
+// is odd (a write is in progress) or changed while they were copying.
+//
+// Readers use the clock without a reference of their own. They count
+// themselves in state_readers for as long as they might, so clocks are
+// only released once the last reader that could have seen them is out.
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static inline void
+bp_state_write_begin (BansheePlayer *player)
+{
+    g_mutex_lock (player->mutex);
+    g_atomic_int_inc (&player->state_sequence);
+}
+
+static inline void
+bp_state_write_end (BansheePlayer *player)
+{
+    g_atomic_int_inc (&player->state_sequence);
+    g_mutex_unlock (player->mutex);
+}
+
+static void
+bp_state_set_clock (BansheePlayer *player, GstClock *clock)
+{
+    // Readers may still be using the previous clock without holding a
+    // reference, so retired clocks are kept alive until the pipeline goes
+    // and _bp_state_destroy has seen the last reader out
+    if (player->state_clock != NULL && player->state_clock != clock) {
+        player->state_retired_clocks = g_slist_prepend (player->state_retired_clocks,
+            player->state_clock);
+    } else if (player->state_clock != NULL) {
+        gst_object_unref (player->state_clock);
+    }
+    
+    player->state_clock = clock;
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void
+_bp_state_reset (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    bp_state_write_begin (player);
+    player->state_segment_time = 0;
+    player->state_segment_accum = 0;
+    player->state_segment_rate = 1.0;
+    player->state_running_time = 0;
+    player->state_base_time = GST_CLOCK_TIME_NONE;
+    player->state_duration = GST_CLOCK_TIME_NONE;
+    player->state_can_seek = FALSE;
+    bp_state_write_end (player);
+}
+
+void
+_bp_state_destroy (BansheePlayer *player)
+{
+    GSList *node;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    bp_state_write_begin (player);
+    bp_state_set_clock (player, NULL);
+    player->state_current = GST_STATE_NULL;
+    player->state_base_time = GST_CLOCK_TIME_NONE;
+    bp_state_write_end (player);
+    
+    // The streaming threads are gone by now, but a getter on another
+    // thread may still be reading the old clock. Any reader starting
+    // from here on sees none, so this only waits for a clock query.
+    while (g_atomic_int_get (&player->state_readers) > 0) {
+        g_thread_yield ();
+    }
+    
+    for (node = player->state_retired_clocks; node != NULL; node = node->next) {
+        gst_object_unref (node->data);
+    }
+    
+    g_slist_free (player->state_retired_clocks);
+    player->state_retired_clocks = NULL;
+    
+    _bp_state_reset (player);
+}
+
+void
+_bp_state_handle_flush (BansheePlayer *player)
+{
+    // Running time starts over after a flush, and the pipeline picks
+    // a new base time when it goes back to PLAYING
+    bp_state_write_begin (player);
+    player->state_segment_accum = 0;
+    player->state_running_time = 0;
+    player->state_base_time = GST_CLOCK_TIME_NONE;
+    bp_state_write_end (player);
+}
+
+void
+_bp_state_handle_segment (BansheePlayer *player, const GstSegment *segment, GstClockTime played)
+{
+    gint64 accum = segment->accum;
+    
+    // played is the running time the previous segment ended at, when this
+    // one follows it without a flush (a gapless transition). The new
+    // segment has to start there; if accum is short of it, the previous
+    // segment never learned how far it got, and the position would jump
+    // back by the length of the previous track
+    if (GST_CLOCK_TIME_IS_VALID (played) && accum < (gint64)played) {
+        bp_debug ("Segment starts at running time %" G_GINT64_FORMAT " but %" G_GUINT64_FORMAT 
+            " was already played, using the latter", accum, played);
+        accum = played;
+    }
+    
+    bp_state_write_begin (player);
+    player->state_segment_time = segment->time;
+    player->state_segment_accum = accum;
+    player->state_segment_rate = segment->rate * segment->applied_rate;
+    bp_state_write_end (player);
+}
+
+void
+_bp_state_handle_state_changed (BansheePlayer *player, GstState old, GstState new)
+{
+    GstClock *clock = NULL;
+    GstClockTime base_time = GST_CLOCK_TIME_NONE;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (new == GST_STATE_PLAYING) {
+        clock = gst_pipeline_get_clock (GST_PIPELINE (player->playbin));
+        base_time = gst_element_get_base_time (player->playbin);
+    }
+    
+    bp_state_write_begin (player);
+    
+    player->state_current = new;
+    
+    if (new == GST_STATE_PLAYING) {
+        bp_state_set_clock (player, clock);
+        player->state_base_time = base_time;
+    } else if (old == GST_STATE_PLAYING && player->state_clock != NULL && 
+        GST_CLOCK_TIME_IS_VALID (player->state_base_time)) {
+        // Freeze the running time where we paused
+        player->state_running_time = gst_clock_get_time (player->state_clock) - player->state_base_time;
+        player->state_base_time = GST_CLOCK_TIME_NONE;
+    } else if (new <= GST_STATE_READY) {
+        player->state_segment_time = 0;
+        player->state_segment_accum = 0;
+        player->state_running_time = 0;
+        player->state_base_time = GST_CLOCK_TIME_NONE;
+        player->state_duration = GST_CLOCK_TIME_NONE;
+        player->state_can_seek = FALSE;
+    }
+    
+    bp_state_write_end (player);
+}
+
+void
+_bp_state_refresh_duration (BansheePlayer *player)
+{
+    static GstFormat format = GST_FORMAT_TIME;
+    GstClockTime duration = GST_CLOCK_TIME_NONE;
+    gint64 queried_duration;
+    gboolean can_seek = TRUE;
+    GstQuery *query;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->playbin == NULL) {
+        return;
+    }
+    
+    // These are the only queries left; they run once when a stream is
+    // loaded or announces a new duration, not every time the host asks
+    if (gst_element_query_duration (player->playbin, &format, &queried_duration) && queried_duration >= 0) {
+        duration = (GstClockTime)queried_duration;
+    }
+    
+    query = gst_query_new_seeking (GST_FORMAT_TIME);
+    if (gst_element_query (player->playbin, query)) {
+        gst_query_parse_seeking (query, NULL, &can_seek, NULL, NULL);
+    }
+    gst_query_unref (query);
+    
+    bp_state_write_begin (player);
+    player->state_duration = duration;
+    player->state_can_seek = can_seek && GST_CLOCK_TIME_IS_VALID (duration) && duration > 0;
+    bp_state_write_end (player);
+}
+
+void
+_bp_state_set_suspended (BansheePlayer *player, gboolean suspended, 
+    guint64 position_ms, guint64 duration_ms)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // The suspend code owns the real state under the pipeline lock; this
+    // is the copy the getters see while playbin is down
+    bp_state_write_begin (player);
+    player->state_suspended = suspended;
+    player->state_suspend_position = position_ms;
+    player->state_suspend_duration = duration_ms;
+    bp_state_write_end (player);
+}
+
+void
+_bp_state_get_snapshot (BansheePlayer *player, BpStateSnapshot *snapshot)
+{
+    gint sequence;
+    gint64 segment_time, segment_accum;
+    GstClockTime running_time, duration;
+    gint64 position;
+    gdouble rate;
+    GstClock *clock;
+    guint64 suspend_position, suspend_duration;
+    
+    g_atomic_int_inc (&player->state_readers);
+    
+    do {
+        sequence = g_atomic_int_get (&player->state_sequence);
+        
+        segment_time = player->state_segment_time;
+        segment_accum = player->state_segment_accum;
+        rate = player->state_segment_rate;
+        running_time = player->state_running_time;
+        duration = player->state_duration;
+        clock = player->state_clock;
+        suspend_position = player->state_suspend_position;
+        suspend_duration = player->state_suspend_duration;
+        
+        snapshot->suspended = player->state_suspended;
+        snapshot->state = player->state_current;
+        snapshot->can_seek = player->state_can_seek;
+        snapshot->base_time = player->state_base_time;
+    } while ((sequence & 1) != 0 || sequence != g_atomic_int_get (&player->state_sequence));
+    
+    snapshot->rate = rate;
+    snapshot->clock_time = GST_CLOCK_TIME_NONE;
+    
+    if (clock != NULL && GST_CLOCK_TIME_IS_VALID (snapshot->base_time)) {
+        // Interpolate from the pipeline clock, the same way the sink
+        // maps running time to what is actually being heard
+        snapshot->clock_time = gst_clock_get_time (clock);
+        running_time = snapshot->clock_time > snapshot->base_time
+            ? snapshot->clock_time - snapshot->base_time
+            : 0;
+    }
+    
+    g_atomic_int_add (&player->state_readers, -1);
+    
+    // A suspended player reports where it will resume, not the stream
+    // playbin is prerolling on the way back
+    if (snapshot->suspended) {
+        snapshot->position = suspend_position;
+        snapshot->duration = suspend_duration;
+        return;
+    }
+    
+    position = segment_time + (gint64)(((gint64)running_time - segment_accum) * ABS (rate));
+    
+    // Data for the next track may already be queued while the end of the
+    // previous one is still playing
+    if (position < segment_time) {
+        position = segment_time;
+    }
+    
+    if (GST_CLOCK_TIME_IS_VALID (duration) && position > (gint64)duration) {
+        position = duration;
+    }
+    
+    snapshot->position = position / GST_MSECOND;
+    snapshot->duration = GST_CLOCK_TIME_IS_VALID (duration) ? duration / GST_MSECOND : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE void
+bp_get_state_snapshot (BansheePlayer *player, BpStateSnapshot *snapshot)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    g_return_if_fail (snapshot != NULL);
+    
+    _bp_state_get_snapshot (player, snapshot);
+}
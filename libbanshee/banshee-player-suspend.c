@@ -0,0 +1,250 @@
+//
+// banshee-player-suspend.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "banshee-player-suspend.h"
+#include "banshee-player-latency.h"
+#include "banshee-player-state.h"
+
+// A suspended player keeps its audio bin but takes playbin to NULL, which
+// frees the decoders, their buffers and everything queued downstream.
+// Resuming prerolls the same URI in PAUSED, then issues one accurate seek
+// back to where we were and only then returns to the state we left.
+//
+// While suspended, or still on the way back, the host is not told about
+// any of the state changes in between; as far as it is concerned the
+// player never left the state it was suspended in.
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+bp_suspend_publish (BansheePlayer *player)
+{
+    // The getters don't take the pipeline lock, so they read the phase
+    // and resume point from the state snapshot
+    _bp_state_set_suspended (player, player->suspend_phase != BP_SUSPEND_NONE, 
+        player->suspend_position, player->suspend_duration);
+}
+
+static gchar *
+bp_suspend_get_current_uri (BansheePlayer *player)
+{
+    gchar *uri = NULL;
+    
+    // Once about-to-finish has queued the next track, playbin2's "uri"
+    // already names that one; "current-uri" is what is actually playing
+    if (g_object_class_find_property (G_OBJECT_GET_CLASS (player->playbin), "current-uri")) {
+        g_object_get (player->playbin, "current-uri", &uri, NULL);
+    }
+    
+    if (uri == NULL) {
+        g_object_get (player->playbin, "uri", &uri, NULL);
+    }
+    
+    return uri;
+}
+
+static gboolean
+bp_suspend_unlocked (BansheePlayer *player)
+{
+    BpStateSnapshot snapshot;
+    gchar *uri;
+    
+    if (player->playbin == NULL || player->suspend_phase != BP_SUSPEND_NONE) {
+        return FALSE;
+    }
+    
+    _bp_state_get_snapshot (player, &snapshot);
+    if (snapshot.state < GST_STATE_PAUSED) {
+        return FALSE;
+    }
+    
+    if ((uri = bp_suspend_get_current_uri (player)) == NULL) {
+        return FALSE;
+    }
+    
+    player->suspend_uri = uri;
+    player->suspend_position = snapshot.position;
+    player->suspend_duration = snapshot.duration;
+    player->suspend_state = player->target_state == GST_STATE_PLAYING 
+        ? GST_STATE_PLAYING : GST_STATE_PAUSED;
+    player->suspend_phase = BP_SUSPEND_SUSPENDED;
+    bp_suspend_publish (player);
+    
+    bp_debug ("Suspending at %" G_GUINT64_FORMAT " ms", player->suspend_position);
+    
+    player->target_state = GST_STATE_NULL;
+    gst_element_set_state (player->playbin, GST_STATE_NULL);
+    
+    // Nothing will be read from the vis adapter till we are back
+    if (player->vis_buffer != NULL) {
+        gst_adapter_clear (player->vis_buffer);
+    }
+    
+    return TRUE;
+}
+
+static gboolean
+bp_resume_unlocked (BansheePlayer *player)
+{
+    if (player->playbin == NULL || player->suspend_phase != BP_SUSPEND_SUSPENDED) {
+        return FALSE;
+    }
+    
+    _bp_latency_arm (player, BP_LATENCY_RESUME, TRUE);
+    
+    player->suspend_phase = BP_SUSPEND_PREROLLING;
+    player->target_state = GST_STATE_PAUSED;
+    
+    g_object_set (player->playbin, "uri", player->suspend_uri, NULL);
+    
+    if (gst_element_set_state (player->playbin, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE) {
+        _bp_latency_disarm (player, BP_LATENCY_RESUME);
+        player->suspend_phase = BP_SUSPEND_SUSPENDED;
+        return FALSE;
+    }
+    
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void
+_bp_suspend_reset (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    g_free (player->suspend_uri);
+    player->suspend_uri = NULL;
+    player->suspend_phase = BP_SUSPEND_NONE;
+    player->suspend_position = 0;
+    player->suspend_duration = 0;
+    bp_suspend_publish (player);
+}
+
+gboolean
+_bp_suspend_set_position (BansheePlayer *player, guint64 time_ms)
+{
+    // A seek while suspended just moves the resume point
+    if (player->suspend_phase == BP_SUSPEND_NONE || player->suspend_phase == BP_SUSPEND_SEEKING) {
+        return FALSE;
+    }
+    
+    player->suspend_position = time_ms;
+    bp_suspend_publish (player);
+    return TRUE;
+}
+
+void
+_bp_suspend_handle_async_done (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    switch (player->suspend_phase) {
+        case BP_SUSPEND_PREROLLING:
+            // Prerolled at the start of the stream; now the one seek
+            player->suspend_phase = BP_SUSPEND_SEEKING;
+            
+            if (player->suspend_position > 0 && gst_element_seek (player->playbin, 1.0, 
+                GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+                GST_SEEK_TYPE_SET, player->suspend_position * GST_MSECOND, 
+                GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE)) {
+                break;
+            }
+            
+            // Nothing to seek to, or the seek failed; carry on from here.
+            // No flush is coming, and the buffer that ended the resume has
+            // already prerolled, so there is nothing left to measure.
+            _bp_latency_disarm (player, BP_LATENCY_RESUME);
+            
+        case BP_SUSPEND_SEEKING:
+            player->suspend_phase = BP_SUSPEND_NONE;
+            bp_suspend_publish (player);
+            player->target_state = player->suspend_state;
+            
+            if (player->suspend_state == GST_STATE_PLAYING) {
+                gst_element_set_state (player->playbin, GST_STATE_PLAYING);
+            }
+            
+            bp_debug ("Resumed at %" G_GUINT64_FORMAT " ms", player->suspend_position);
+            
+            g_free (player->suspend_uri);
+            player->suspend_uri = NULL;
+            break;
+            
+        default:
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE gboolean
+bp_suspend (BansheePlayer *player)
+{
+    gboolean suspended;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    bp_pipeline_lock (player);
+    suspended = bp_suspend_unlocked (player);
+    bp_pipeline_unlock (player);
+    
+    return suspended;
+}
+
+P_INVOKE gboolean
+bp_resume (BansheePlayer *player)
+{
+    gboolean resumed;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    bp_pipeline_lock (player);
+    resumed = bp_resume_unlocked (player);
+    bp_pipeline_unlock (player);
+    
+    return resumed;
+}
+
+P_INVOKE gboolean
+bp_is_suspended (BansheePlayer *player)
+{
+    BpStateSnapshot snapshot;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    _bp_state_get_snapshot (player, &snapshot);
+    return snapshot.suspended;
+}
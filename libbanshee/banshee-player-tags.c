@@ -0,0 +1,228 @@
+//
+// banshee-player-tags.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "banshee-player-events.h"
+#include "banshee-player-tags.h"
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+bp_tags_legacy_dispatch (const GstTagList *tag_list, const gchar *tag_name, BansheePlayer *player)
+{
+    const GValue *value;
+    
+    if (gst_tag_list_get_tag_size (tag_list, tag_name) < 1) {
+        return;
+    }
+    
+    value = gst_tag_list_get_value_index (tag_list, tag_name, 0);
+
+    if (value != NULL) {
+        player->tag_found_cb (player, tag_name, value);
+    }
+}
+
+static gboolean
+bp_tags_pack_value (BpTag *tag, const GValue *value)
+{
+    // The one boxed value with a flat form: dates go as a julian day
+    // (1 is January 1st of year 1), like g_date_get_julian
+    if (G_VALUE_TYPE (value) == GST_TYPE_DATE) {
+        const GDate *date = gst_value_get_date (value);
+        
+        if (date == NULL || !g_date_valid (date)) {
+            return FALSE;
+        }
+        
+        tag->type = BP_TAG_TYPE_DATE;
+        tag->int_value = g_date_get_julian (date);
+        return TRUE;
+    }
+    
+    switch (G_TYPE_FUNDAMENTAL (G_VALUE_TYPE (value))) {
+        case G_TYPE_INT:
+            tag->type = BP_TAG_TYPE_INT;
+            tag->int_value = g_value_get_int (value);
+            return TRUE;
+        case G_TYPE_UINT:
+            tag->type = BP_TAG_TYPE_UINT;
+            tag->int_value = g_value_get_uint (value);
+            return TRUE;
+        case G_TYPE_INT64:
+            tag->type = BP_TAG_TYPE_INT64;
+            tag->int_value = g_value_get_int64 (value);
+            return TRUE;
+        case G_TYPE_UINT64:
+            tag->type = BP_TAG_TYPE_UINT64;
+            tag->int_value = (gint64)g_value_get_uint64 (value);
+            return TRUE;
+        case G_TYPE_BOOLEAN:
+            tag->type = BP_TAG_TYPE_BOOLEAN;
+            tag->int_value = g_value_get_boolean (value);
+            return TRUE;
+        case G_TYPE_FLOAT:
+            tag->type = BP_TAG_TYPE_DOUBLE;
+            tag->double_value = g_value_get_float (value);
+            return TRUE;
+        case G_TYPE_DOUBLE:
+            tag->type = BP_TAG_TYPE_DOUBLE;
+            tag->double_value = g_value_get_double (value);
+            return TRUE;
+        case G_TYPE_STRING:
+            tag->type = BP_TAG_TYPE_STRING;
+            tag->string_value = g_value_get_string (value);
+            return tag->string_value != NULL;
+        default:
+            // Images and other boxed values have no flat form
+            return FALSE;
+    }
+}
+
+static gboolean
+bp_tags_is_repeat (BansheePlayer *player, const gchar *tag_name, const GValue *value)
+{
+    const GValue *cached;
+    
+    if (player->tag_cache == NULL || gst_tag_list_get_tag_size (player->tag_cache, tag_name) < 1) {
+        return FALSE;
+    }
+    
+    cached = gst_tag_list_get_value_index (player->tag_cache, tag_name, 0);
+    return cached != NULL && G_VALUE_TYPE (cached) == G_VALUE_TYPE (value) && 
+        gst_value_compare (cached, value) == GST_VALUE_EQUAL;
+}
+
+static void
+bp_tags_collect (const GstTagList *tag_list, const gchar *tag_name, BansheePlayer *player)
+{
+    const GValue *value;
+    BpTag tag = { 0, };
+    
+    if (gst_tag_list_get_tag_size (tag_list, tag_name) < 1 ||
+        (value = gst_tag_list_get_value_index (tag_list, tag_name, 0)) == NULL) {
+        return;
+    }
+    
+    if (bp_tags_is_repeat (player, tag_name, value)) {
+        player->tags_suppressed++;
+        return;
+    }
+    
+    tag.quark = g_quark_from_string (tag_name);
+    tag.name = g_quark_to_string (tag.quark);
+    
+    if (bp_tags_pack_value (&tag, value)) {
+        g_array_append_val (player->tag_batch, tag);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void
+_bp_tags_destroy (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->tag_cache != NULL) {
+        gst_tag_list_free (player->tag_cache);
+        player->tag_cache = NULL;
+    }
+    
+    if (player->tag_batch != NULL) {
+        g_array_free (player->tag_batch, TRUE);
+        player->tag_batch = NULL;
+    }
+}
+
+void
+_bp_tags_reset (BansheePlayer *player)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // A new stream is starting; the cache is owned by whichever thread
+    // dispatches tags, so only flag it here and let that thread drop it
+    g_atomic_int_set (&player->tag_cache_reset, TRUE);
+}
+
+void
+_bp_tags_dispatch (BansheePlayer *player, const GstTagList *tag_list)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->tag_found_cb != NULL && !player->events_enabled) {
+        gst_tag_list_foreach (tag_list, (GstTagForeachFunc)bp_tags_legacy_dispatch, player);
+    }
+    
+    if (player->tags_found_cb == NULL && !player->events_enabled) {
+        return;
+    }
+    
+    if (g_atomic_int_compare_and_exchange (&player->tag_cache_reset, TRUE, FALSE) && 
+        player->tag_cache != NULL) {
+        gst_tag_list_free (player->tag_cache);
+        player->tag_cache = NULL;
+    }
+    
+    if (player->tag_batch == NULL) {
+        player->tag_batch = g_array_sized_new (FALSE, FALSE, sizeof (BpTag), 16);
+    }
+    
+    g_array_set_size (player->tag_batch, 0);
+    gst_tag_list_foreach (tag_list, (GstTagForeachFunc)bp_tags_collect, player);
+    
+    if (player->tag_cache == NULL) {
+        player->tag_cache = gst_tag_list_copy (tag_list);
+    } else {
+        gst_tag_list_insert (player->tag_cache, tag_list, GST_TAG_MERGE_REPLACE);
+    }
+    
+    if (player->tag_batch->len > 0) {
+        _bp_events_emit_tags (player, (BpTag *)player->tag_batch->data, player->tag_batch->len);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE void
+bp_set_tags_found_callback (BansheePlayer *player, BansheePlayerTagsFoundCallback cb)
+{
+    SET_CALLBACK (tags_found_cb);
+}
+
+P_INVOKE guint64
+bp_get_tags_suppressed (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
+    return player->tags_suppressed;
+}
@@ -0,0 +1,549 @@
+//
+// banshee-player-tee.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "banshee-player-tee.h"
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static BpTeeBranch *
+bp_tee_find_branch (BansheePlayer *player, GstElement *element)
+{
+    GSList *node;
+    
+    for (node = player->tee_branches; node != NULL; node = node->next) {
+        if (((BpTeeBranch *)node->data)->element == element) {
+            return (BpTeeBranch *)node->data;
+        }
+    }
+    
+    return NULL;
+}
+
+static void
+bp_tee_branch_free (BansheePlayer *player, BpTeeBranch *branch)
+{
+    player->tee_branches = g_slist_remove (player->tee_branches, branch);
+    
+    if (branch->tee_pad != NULL) {
+        gst_object_unref (branch->tee_pad);
+    }
+    
+    gst_object_unref (branch->element);
+    g_free (branch);
+}
+
+static gboolean
+bp_tee_is_dynamic (BansheePlayer *player)
+{
+    // Without alloc-pad (GStreamer < 0.10.23) the tee allocates buffers
+    // from its most recently requested pad, so pads requested after src0
+    // must stay linked for good or the pipeline stalls once they go away
+    return g_object_class_find_property (G_OBJECT_GET_CLASS (player->audiotee), "alloc-pad") != NULL;
+}
+
+static gboolean
+bp_tee_branch_drop (GstPad *pad, GstBuffer *buffer, gpointer data)
+{
+    return FALSE;
+}
+
+static gboolean
+bp_tee_is_flowing (BansheePlayer *player)
+{
+    GstState state, pending;
+    
+    // PAUSED counts too: the queues keep filling until the sink prerolls
+    
+    gst_element_get_state (player->audiobin, &state, &pending, 0);
+    return state > GST_STATE_READY || pending > GST_STATE_READY;
+}
+
+static void
+bp_tee_branch_replay_segment (BansheePlayer *player, BpTeeBranch *branch)
+{
+    GstSegment *segment = player->segment;
+    GstPad *pad;
+    
+    if (segment == NULL) {
+        return;
+    }
+    
+    // A branch linked mid-stream never saw the segment the tee is in, so
+    // replay it before the first buffer arrives. The first segment only
+    // carries the running time accumulated by earlier segments, which a
+    // synchronizing sink in the branch needs to line up with the audio.
+    pad = gst_element_get_static_pad (branch->element, "sink");
+    
+    if (segment->accum > 0) {
+        gst_pad_send_event (pad, gst_event_new_new_segment_full (FALSE, 1.0, 1.0, 
+            GST_FORMAT_TIME, 0, segment->accum, 0));
+    }
+    
+    gst_pad_send_event (pad, gst_event_new_new_segment_full (FALSE, segment->rate, 
+        segment->applied_rate, GST_FORMAT_TIME, segment->start, segment->stop, segment->time));
+    
+    gst_object_unref (pad);
+}
+
+static void
+bp_tee_branch_link (BansheePlayer *player, BpTeeBranch *branch)
+{
+    GstPad *pad;
+    
+    pad = gst_element_get_static_pad (branch->element, "sink");
+    branch->tee_pad = gst_element_get_request_pad (player->audiotee, "src%d");
+    gst_pad_link (branch->tee_pad, pad);
+    gst_object_unref (pad);
+}
+
+static void
+bp_tee_branch_unlink (BansheePlayer *player, BpTeeBranch *branch)
+{
+    GstPad *pad;
+    
+    pad = gst_element_get_static_pad (branch->element, "sink");
+    gst_pad_unlink (branch->tee_pad, pad);
+    gst_object_unref (pad);
+    
+    if (branch->drop_probe_id != 0) {
+        gst_pad_remove_buffer_probe (branch->tee_pad, branch->drop_probe_id);
+        branch->drop_probe_id = 0;
+    }
+    
+    gst_element_release_request_pad (player->audiotee, branch->tee_pad);
+    gst_object_unref (branch->tee_pad);
+    branch->tee_pad = NULL;
+}
+
+static void
+bp_tee_branch_shutdown (BansheePlayer *player, BpTeeBranch *branch)
+{
+    // Park the branch in NULL and keep it there, whatever the bin does
+    gst_element_set_locked_state (branch->element, TRUE);
+    gst_element_set_state (branch->element, GST_STATE_NULL);
+    
+    if (branch->removed) {
+        gst_bin_remove (GST_BIN (player->audiobin), branch->element);
+        bp_tee_branch_free (player, branch);
+    }
+}
+
+static void
+bp_tee_branch_remove_probe (BansheePlayer *player, BpTeeBranch *branch)
+{
+    GstPad *pad;
+    
+    if (branch->probe_id == 0) {
+        return;
+    }
+    
+    pad = gst_element_get_static_pad (player->audiotee, "sink");
+    gst_pad_remove_buffer_probe (pad, branch->probe_id);
+    gst_object_unref (pad);
+    branch->probe_id = 0;
+}
+
+static void
+bp_tee_branch_add_probe (BansheePlayer *player, BpTeeBranch *branch, GCallback probe)
+{
+    GstPad *pad;
+    
+    pad = gst_element_get_static_pad (player->audiotee, "sink");
+    branch->probe_id = gst_pad_add_buffer_probe (pad, probe, player);
+    gst_object_unref (pad);
+}
+
+static gboolean
+bp_tee_branch_probe (GstPad *teepad, GstBuffer *buffer, BansheePlayer *player)
+{
+    BpTeeBranch *branch;
+    GSList *node;
+    
+    // Buffer probes on the tee's sink pad run before the tee pushes
+    // anything, so its src pads can be linked here without racing it.
+    // The probe only holds on to the player and looks its branches up
+    // under the mutex; a branch may have been freed since it was added.
+    g_mutex_lock (player->tee_mutex);
+    
+    for (node = player->tee_branches; node != NULL; node = node->next) {
+        branch = (BpTeeBranch *)node->data;
+        
+        if (branch->probe_id == 0) {
+            continue;
+        }
+        
+        gst_pad_remove_buffer_probe (teepad, branch->probe_id);
+        branch->probe_id = 0;
+        
+        // Only pads are touched here; state changes of the branch happen
+        // on the thread that asked for them, see bp_tee_branch_update
+        if (branch->attached && branch->tee_pad == NULL) {
+            bp_tee_branch_replay_segment (player, branch);
+            bp_tee_branch_link (player, branch);
+        }
+    }
+    
+    g_mutex_unlock (player->tee_mutex);
+    
+    return TRUE;
+}
+
+static void bp_tee_branch_update (BansheePlayer *player, BpTeeBranch *branch);
+
+static gboolean
+bp_tee_finish_detach (BansheePlayer *player)
+{
+    BpTeeBranch *branch;
+    GSList *node, *next;
+    
+    g_mutex_lock (player->tee_mutex);
+    
+    player->tee_source = NULL;
+    
+    for (node = player->tee_branches; node != NULL; node = next) {
+        branch = (BpTeeBranch *)node->data;
+        next = node->next;
+        
+        if (!branch->unlinked) {
+            continue;
+        }
+        
+        gst_element_release_request_pad (player->audiotee, branch->tee_pad);
+        gst_object_unref (branch->tee_pad);
+        branch->tee_pad = NULL;
+        branch->unlinked = FALSE;
+        branch->detaching = FALSE;
+        
+        // Attached again while it was coming off; link it back up
+        if (branch->attached) {
+            bp_tee_branch_update (player, branch);
+        } else {
+            bp_tee_branch_shutdown (player, branch);
+        }
+    }
+    
+    g_mutex_unlock (player->tee_mutex);
+    
+    return FALSE;
+}
+
+static void
+bp_tee_branch_blocked (GstPad *teepad, gboolean blocked, BansheePlayer *player)
+{
+    BpTeeBranch *branch;
+    GSList *node;
+    GstPad *pad;
+    
+    if (!blocked) {
+        return;
+    }
+    
+    // The streaming thread is held on this pad, so it can come off the
+    // branch here. Releasing it and shutting the branch down is left to
+    // the main context; neither belongs on the streaming thread.
+    g_mutex_lock (player->tee_mutex);
+    
+    for (node = player->tee_branches; node != NULL; node = node->next) {
+        branch = (BpTeeBranch *)node->data;
+        
+        if (branch->tee_pad != teepad || !branch->detaching || branch->unlinked) {
+            continue;
+        }
+        
+        pad = gst_element_get_static_pad (branch->element, "sink");
+        gst_pad_unlink (teepad, pad);
+        gst_object_unref (pad);
+        branch->unlinked = TRUE;
+        
+        if (player->tee_source == NULL) {
+            player->tee_source = g_idle_source_new ();
+            g_source_set_callback (player->tee_source, (GSourceFunc)bp_tee_finish_detach, player, NULL);
+            g_source_attach (player->tee_source, NULL);
+            g_source_unref (player->tee_source);
+        }
+    }
+    
+    g_mutex_unlock (player->tee_mutex);
+    
+    // Unlinked or attached again in the meantime, either way let it go
+    gst_pad_set_blocked_async (teepad, FALSE, (GstPadBlockCallback)bp_tee_branch_blocked, player);
+}
+
+static void
+bp_tee_branch_cancel_detach (BansheePlayer *player, BpTeeBranch *branch)
+{
+    // Only while the pad is still linked; once unlinked it is up to
+    // bp_tee_finish_detach
+    branch->detaching = FALSE;
+    gst_pad_set_blocked_async (branch->tee_pad, FALSE, (GstPadBlockCallback)bp_tee_branch_blocked, player);
+}
+
+static void
+bp_tee_branch_detach (BansheePlayer *player, BpTeeBranch *branch)
+{
+    if (branch->tee_pad == NULL) {
+        // Never got linked; drop the link still pending, if any
+        bp_tee_branch_remove_probe (player, branch);
+        bp_tee_branch_shutdown (player, branch);
+        return;
+    }
+    
+    if (branch->detaching) {
+        return;
+    }
+    
+    // Block the tee's pad and unlink it once the streaming thread waits
+    // there. Nobody waits for that here: in PAUSED the tee may not push
+    // anything till playback goes on, and the branch comes off then.
+    branch->detaching = TRUE;
+    gst_pad_set_blocked_async (branch->tee_pad, TRUE, (GstPadBlockCallback)bp_tee_branch_blocked, player);
+}
+
+static void
+bp_tee_branch_update (BansheePlayer *player, BpTeeBranch *branch)
+{
+    if (!bp_tee_is_dynamic (player) && !branch->removed) {
+        // The branch stays linked and running; a detached one just has
+        // its buffers dropped before they leave the tee
+        if (branch->tee_pad == NULL) {
+            gst_element_set_locked_state (branch->element, FALSE);
+            gst_element_sync_state_with_parent (branch->element);
+            bp_tee_branch_link (player, branch);
+        }
+        
+        if (branch->attached && branch->drop_probe_id != 0) {
+            gst_pad_remove_buffer_probe (branch->tee_pad, branch->drop_probe_id);
+            branch->drop_probe_id = 0;
+        } else if (!branch->attached && branch->drop_probe_id == 0) {
+            branch->drop_probe_id = gst_pad_add_buffer_probe (branch->tee_pad, 
+                G_CALLBACK (bp_tee_branch_drop), NULL);
+        }
+        return;
+    }
+    
+    // Unlinked already; bp_tee_finish_detach picks up whatever was asked
+    // for last
+    if (branch->unlinked) {
+        return;
+    }
+    
+    if (!bp_tee_is_flowing (player)) {
+        // Nothing is being pushed through the tee, change it right away
+        bp_tee_branch_remove_probe (player, branch);
+        
+        if (branch->detaching) {
+            bp_tee_branch_cancel_detach (player, branch);
+        }
+        
+        if (branch->attached && branch->tee_pad == NULL) {
+            gst_element_set_locked_state (branch->element, FALSE);
+            bp_tee_branch_link (player, branch);
+        } else if (!branch->attached) {
+            if (branch->tee_pad != NULL) {
+                bp_tee_branch_unlink (player, branch);
+            }
+            
+            bp_tee_branch_shutdown (player, branch);
+        }
+        return;
+    }
+    
+    if (!branch->attached) {
+        bp_tee_branch_detach (player, branch);
+        return;
+    }
+    
+    // Still linked, so there is nothing to do but keep it that way
+    if (branch->detaching) {
+        bp_tee_branch_cancel_detach (player, branch);
+        return;
+    }
+    
+    // A pending probe picks up whatever was asked for last
+    if (branch->tee_pad != NULL || branch->probe_id != 0) {
+        return;
+    }
+    
+    // Bring the branch up to the running state first, so it is ready
+    // for the buffer that follows the link
+    gst_element_set_locked_state (branch->element, FALSE);
+    gst_element_sync_state_with_parent (branch->element);
+    bp_tee_branch_add_probe (player, branch, G_CALLBACK (bp_tee_branch_probe));
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void
+_bp_tee_pipeline_destroy (BansheePlayer *player)
+{
+    BpTeeBranch *branch;
+    GstPad *pad = NULL;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->audiotee != NULL) {
+        pad = gst_element_get_static_pad (player->audiotee, "sink");
+    }
+    
+    g_mutex_lock (player->tee_mutex);
+    
+    if (player->tee_source != NULL) {
+        g_source_destroy (player->tee_source);
+        player->tee_source = NULL;
+    }
+    
+    while (player->tee_branches != NULL) {
+        branch = (BpTeeBranch *)player->tee_branches->data;
+        
+        if (branch->probe_id != 0 && pad != NULL) {
+            gst_pad_remove_buffer_probe (pad, branch->probe_id);
+        }
+        
+        // The branches go down with the audio bin
+        bp_tee_branch_free (player, branch);
+    }
+    
+    g_mutex_unlock (player->tee_mutex);
+    
+    if (pad != NULL) {
+        gst_object_unref (pad);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE gboolean
+bp_tee_add_branch (BansheePlayer *player, GstElement *element, gboolean attached)
+{
+    BpTeeBranch *branch;
+    GstPad *pad;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    g_return_val_if_fail (GST_IS_ELEMENT (element), FALSE);
+    
+    if (player->audiobin == NULL) {
+        return FALSE;
+    }
+    
+    pad = gst_element_get_static_pad (element, "sink");
+    if (pad == NULL) {
+        bp_debug ("Tee branch %s has no sink pad", GST_ELEMENT_NAME (element));
+        return FALSE;
+    }
+    gst_object_unref (pad);
+    
+    g_mutex_lock (player->tee_mutex);
+    
+    if (bp_tee_find_branch (player, element) != NULL) {
+        g_mutex_unlock (player->tee_mutex);
+        return FALSE;
+    }
+    
+    branch = g_new0 (BpTeeBranch, 1);
+    branch->player = player;
+    branch->element = gst_object_ref (element);
+    branch->attached = attached;
+    player->tee_branches = g_slist_prepend (player->tee_branches, branch);
+    
+    // Branches start out detached and parked in NULL
+    gst_element_set_locked_state (element, TRUE);
+    if (GST_ELEMENT_PARENT (element) == NULL) {
+        gst_bin_add (GST_BIN (player->audiobin), element);
+    }
+    
+    if (attached || !bp_tee_is_dynamic (player)) {
+        bp_tee_branch_update (player, branch);
+    }
+    
+    g_mutex_unlock (player->tee_mutex);
+    
+    return TRUE;
+}
+
+P_INVOKE void
+bp_tee_remove_branch (BansheePlayer *player, GstElement *element)
+{
+    BpTeeBranch *branch;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    g_mutex_lock (player->tee_mutex);
+    
+    if ((branch = bp_tee_find_branch (player, element)) != NULL && !branch->removed) {
+        // The branch leaves the bin once it has been detached
+        branch->removed = TRUE;
+        branch->attached = FALSE;
+        bp_tee_branch_update (player, branch);
+    }
+    
+    g_mutex_unlock (player->tee_mutex);
+}
+
+P_INVOKE void
+bp_tee_set_branch_attached (BansheePlayer *player, GstElement *element, gboolean attached)
+{
+    BpTeeBranch *branch;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    g_mutex_lock (player->tee_mutex);
+    
+    if ((branch = bp_tee_find_branch (player, element)) != NULL && 
+        !branch->removed && branch->attached != attached) {
+        branch->attached = attached;
+        bp_tee_branch_update (player, branch);
+    }
+    
+    g_mutex_unlock (player->tee_mutex);
+}
+
+P_INVOKE gboolean
+bp_tee_get_branch_attached (BansheePlayer *player, GstElement *element)
+{
+    BpTeeBranch *branch;
+    gboolean attached = FALSE;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    g_mutex_lock (player->tee_mutex);
+    
+    if ((branch = bp_tee_find_branch (player, element)) != NULL) {
+        attached = branch->tee_pad != NULL && !branch->detaching && branch->drop_probe_id == 0;
+    }
+    
+    g_mutex_unlock (player->tee_mutex);
+    
+    return attached;
+}
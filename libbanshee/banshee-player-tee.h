@@ -0,0 +1,42 @@
+//
+// banshee-player-tee.h
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _BANSHEE_PLAYER_TEE_H
+#define _BANSHEE_PLAYER_TEE_H
+
+#include "banshee-player-private.h"
+
+void      _bp_tee_pipeline_destroy   (BansheePlayer *player);
+
+gboolean  bp_tee_add_branch          (BansheePlayer *player, GstElement *element, gboolean attached);
+void      bp_tee_remove_branch       (BansheePlayer *player, GstElement *element);
+void      bp_tee_set_branch_attached (BansheePlayer *player, GstElement *element, gboolean attached);
+gboolean  bp_tee_get_branch_attached (BansheePlayer *player, GstElement *element);
+
+#endif /* _BANSHEE_PLAYER_TEE_H */
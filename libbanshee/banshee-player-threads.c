@@ -0,0 +1,227 @@
+//
+// banshee-player-threads.c
+//
+// Author:
+//   Banshee contributors <banshee-list@gnome.org>
+//
+// Copyright (C) 2026 Banshee contributors
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <string.h>
+#include <time.h>
+
+#include "banshee-player-threads.h"
+
+// With the split topology the pipeline runs on these streaming threads:
+//
+//   decode: source ! demuxer ! decoder ! audiotee
+//   dsp:    audiosinkqueue ! audioconvert ! preamp ! equalizer ! audioconvert
+//   sink:   sinkqueue ! audiosink
+//   vis:    vis-queue ! audioconvert ! fakesink
+//
+// plus the vis analysis worker, which does the FFT off the vis thread.
+//
+// In the default topology dsp and sink share the audiosinkqueue thread,
+// and are accounted together as the sink stage.
+//
+// Each stage's stats are published like the state block (see
+// banshee-player-state.c): readers retry while the sequence counter is
+// odd or changed under them.
+
+// ---------------------------------------------------------------------------
+// Private Functions
+// ---------------------------------------------------------------------------
+
+static void
+bp_threads_account (BansheePlayer *player, BpThreadStage stage)
+{
+    BpStageAccount *account = &player->stage_accounts[stage];
+    GThread *self = g_thread_self ();
+    guint64 cpu_time = 0;
+    gint sequence;
+    
+    #if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        cpu_time = (guint64)ts.tv_sec * GST_SECOND + ts.tv_nsec;
+    }
+    #endif
+    
+    // Two threads only meet here while a stage changes hands, and the
+    // one that loses drops its sample rather than wait
+    sequence = g_atomic_int_get (&account->sequence);
+    if ((sequence & 1) != 0 || 
+        !g_atomic_int_compare_and_exchange (&account->sequence, sequence, sequence + 1)) {
+        return;
+    }
+    
+    // A stage is only ever sampled from its own thread; when the thread
+    // behind it changes (e.g. playbin builds a new decoder) start over
+    // from that thread's current consumption
+    if (account->thread == self && cpu_time >= account->last_cpu_time) {
+        account->stats.cpu_time += cpu_time - account->last_cpu_time;
+    } else if (account->thread != self) {
+        account->stats.threads++;
+    }
+    
+    account->thread = self;
+    account->last_cpu_time = cpu_time;
+    account->stats.buffers++;
+    
+    g_atomic_int_inc (&account->sequence);
+}
+
+static gboolean
+bp_threads_decode_probe (GstPad *pad, GstBuffer *buffer, BansheePlayer *player)
+{
+    bp_threads_account (player, BP_THREAD_STAGE_DECODE);
+    return TRUE;
+}
+
+static gboolean
+bp_threads_dsp_probe (GstPad *pad, GstBuffer *buffer, BansheePlayer *player)
+{
+    bp_threads_account (player, BP_THREAD_STAGE_DSP);
+    return TRUE;
+}
+
+static gboolean
+bp_threads_sink_probe (GstPad *pad, GstBuffer *buffer, BansheePlayer *player)
+{
+    bp_threads_account (player, BP_THREAD_STAGE_SINK);
+    return TRUE;
+}
+
+static gboolean
+bp_threads_vis_probe (GstPad *pad, GstBuffer *buffer, BansheePlayer *player)
+{
+    bp_threads_account (player, BP_THREAD_STAGE_VIS);
+    return TRUE;
+}
+
+static void
+bp_threads_add_probe (GstElement *element, const gchar *pad_name, GCallback probe, BansheePlayer *player)
+{
+    GstPad *pad;
+    
+    if (element != NULL && (pad = gst_element_get_static_pad (element, pad_name)) != NULL) {
+        gst_pad_add_buffer_probe (pad, probe, player);
+        gst_object_unref (pad);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+GstElement *
+_bp_threads_sink_queue_new (BansheePlayer *player)
+{
+    GstElement *sinkqueue;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), NULL);
+    
+    if (player->thread_topology != BP_THREAD_TOPOLOGY_SPLIT) {
+        return NULL;
+    }
+    
+    if ((sinkqueue = gst_element_factory_make ("queue", "sinkqueue")) == NULL) {
+        bp_debug ("Could not create the sink queue, using the default thread topology");
+        return NULL;
+    }
+    
+    // Its limits come from the latency profile, see banshee-player-profile.c
+    return sinkqueue;
+}
+
+void
+_bp_threads_pipeline_setup (BansheePlayer *player, GstElement *audiosinkqueue, GstElement *sinkqueue)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    bp_threads_add_probe (player->audiotee, "sink", G_CALLBACK (bp_threads_decode_probe), player);
+    
+    if (sinkqueue != NULL) {
+        bp_threads_add_probe (audiosinkqueue, "src", G_CALLBACK (bp_threads_dsp_probe), player);
+        bp_threads_add_probe (sinkqueue, "src", G_CALLBACK (bp_threads_sink_probe), player);
+    } else {
+        bp_threads_add_probe (audiosinkqueue, "src", G_CALLBACK (bp_threads_sink_probe), player);
+    }
+}
+
+void
+_bp_threads_account_analysis (BansheePlayer *player)
+{
+    // Called by the vis analysis worker once per slice
+    bp_threads_account (player, BP_THREAD_STAGE_ANALYSIS);
+}
+
+void
+_bp_threads_watch_vis_queue (BansheePlayer *player, GstElement *visqueue)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    bp_threads_add_probe (visqueue, "src", G_CALLBACK (bp_threads_vis_probe), player);
+}
+
+// ---------------------------------------------------------------------------
+// Public Functions
+// ---------------------------------------------------------------------------
+
+P_INVOKE gboolean
+bp_set_thread_topology (BansheePlayer *player, BpThreadTopology topology)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    if (player->playbin != NULL) {
+        g_warning ("The thread topology must be set before the pipeline is constructed");
+        return FALSE;
+    }
+    
+    player->thread_topology = topology;
+    return TRUE;
+}
+
+P_INVOKE BpThreadTopology
+bp_get_thread_topology (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), BP_THREAD_TOPOLOGY_DEFAULT);
+    return player->thread_topology;
+}
+
+P_INVOKE gboolean
+bp_get_stage_stats (BansheePlayer *player, BpThreadStage stage, BpStageStats *stats)
+{
+    BpStageAccount *account;
+    gint sequence;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    g_return_val_if_fail (stage < BP_THREAD_STAGE_COUNT && stats != NULL, FALSE);
+    
+    account = &player->stage_accounts[stage];
+    
+    do {
+        sequence = g_atomic_int_get (&account->sequence);
+        *stats = account->stats;
+    } while ((sequence & 1) != 0 || sequence != g_atomic_int_get (&account->sequence));
+    
+    return stats->buffers > 0;
+}
@@ -26,15 +26,25 @@
 // WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
-#include <math.h>
 
 #include "banshee-player-vis.h"
-
+#include "banshee-player-dsp.h"
+#include "banshee-player-events.h"
+#include "banshee-player-health.h"
+#include "banshee-player-tee.h"
+#include "banshee-player-threads.h"
+
+// The reference rate the vis config is given at, and the default hop
+// and FFT size: 60 frames a second, each FFT over the last two slices
+#define BP_VIS_RATE 44100
 #define SLICE_SIZE 735
 
+// Slices waiting for the analysis worker; a power of two
+#define BP_VIS_RING_SIZE 8
+
 static GstStaticCaps vis_data_sink_caps = GST_STATIC_CAPS (
     "audio/x-raw-float, "
-    "rate = (int) 44100, "
+    "rate = (int) [ 1, MAX ], "
     "channels = (int) 2, "
     "endianness = (int) BYTE_ORDER, "
     "width = (int) 32"
@@ -44,120 +54,425 @@ static GstStaticCaps vis_data_sink_caps = GST_STATIC_CAPS (
 // Private Functions
 // ---------------------------------------------------------------------------
 
-static void
-bp_vis_pcm_handoff (GstElement *sink, GstBuffer *buffer, GstPad *pad, gpointer userdata)
+static gfloat *
+bp_vis_scratch (BansheePlayer *player, gfloat *scratch, gint *size, gint wanted)
 {
-    BansheePlayer *player = (BansheePlayer*)userdata;
-    GstStructure *structure;
-    gint channels, wanted_size;
-    gfloat *data;
-    BansheePlayerVisDataCallback vis_data_cb;
-    
-    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    // Only ever grows, so it settles after the first slice of a stream
+    if (*size < wanted) {
+        scratch = g_renew (gfloat, scratch, wanted);
+        *size = wanted;
+        g_atomic_int_inc (&player->vis_allocations);
+    }
     
-    vis_data_cb = player->vis_data_cb;
+    return scratch;
+}
 
-    if (vis_data_cb == NULL) {
-        return;
+static gint
+bp_vis_decimation (gboolean decimate, gint rate)
+{
+    gint factor = 1;
+    
+    // Halving steps down towards the reference rate: 88.2 and 96 kHz
+    // are halved, 176.4 and 192 kHz quartered, 48 kHz is left alone
+    while (decimate && rate / (factor * 2) >= BP_VIS_RATE) {
+        factor *= 2;
     }
+    
+    return factor;
+}
 
-    if (player->vis_thawing) {
-        // Flush our buffers out.
-        gst_adapter_clear (player->vis_buffer);
-        memset (player->vis_fft_sample_buffer, 0, sizeof(gfloat) * SLICE_SIZE);
+static gint
+bp_vis_scale_to_rate (gint size, gint rate)
+{
+    // Sizes in the config are at the reference rate; keep them the
+    // same length in time at whatever rate the stream runs
+    return MAX ((gint)(((gint64)size * rate + BP_VIS_RATE / 2) / BP_VIS_RATE), 1);
+}
 
-        player->vis_thawing = FALSE;
-    }
+// The handoff runs on the vis branch's streaming thread, which is synced
+// to the clock and has 1/120 s to spare before its buffers count as late.
+// All it does is copy each slice of PCM into this ring; the FFT and the
+// host callback run on the analysis worker below. The streaming thread is
+// the only producer and the worker the only consumer, so the ring itself
+// takes no locks; the mutex is only there to park the worker when idle.
+
+static BpVisSlice *
+bp_vis_ring_reserve (BansheePlayer *player)
+{
+    gint head = g_atomic_int_get (&player->vis_ring_head);
     
-    structure = gst_caps_get_structure (gst_buffer_get_caps (buffer), 0);
-    gst_structure_get_int (structure, "channels", &channels);
+    if (head - g_atomic_int_get (&player->vis_ring_tail) >= BP_VIS_RING_SIZE) {
+        return NULL;
+    }
     
-    wanted_size = channels * SLICE_SIZE * sizeof (gfloat);
+    return &player->vis_ring[head & (BP_VIS_RING_SIZE - 1)];
+}
 
-    gst_adapter_push (player->vis_buffer, gst_buffer_copy (buffer));
+static void
+bp_vis_ring_commit (BansheePlayer *player)
+{
+    g_atomic_int_inc (&player->vis_ring_head);
     
-    while ((data = (gfloat *)gst_adapter_peek (player->vis_buffer, wanted_size)) != NULL) {
-        gfloat *deinterlaced = g_malloc (wanted_size);
-        gfloat *specbuf = g_new (gfloat, SLICE_SIZE * 2);
+    if (g_atomic_int_get (&player->vis_worker_idle)) {
+        g_mutex_lock (player->vis_worker_mutex);
+        g_cond_signal (player->vis_worker_cond);
+        g_mutex_unlock (player->vis_worker_mutex);
+    }
+}
 
-        gint i, j;
+static BpVisSlice *
+bp_vis_ring_newest (BansheePlayer *player)
+{
+    gint head = g_atomic_int_get (&player->vis_ring_head);
+    gint tail = g_atomic_int_get (&player->vis_ring_tail);
+    
+    if (head == tail) {
+        return NULL;
+    }
+    
+    // Only the newest frame is worth drawing; a worker that fell behind
+    // skips ahead, and the skipped audio breaks the FFT overlap
+    if (head - tail > 1) {
+        g_atomic_int_add (&player->vis_slices_dropped, head - tail - 1);
+        player->vis_ring[(head - 1) & (BP_VIS_RING_SIZE - 1)].discont = TRUE;
+        g_atomic_int_set (&player->vis_ring_tail, head - 1);
+    }
+    
+    return &player->vis_ring[(head - 1) & (BP_VIS_RING_SIZE - 1)];
+}
 
-        memcpy (specbuf, player->vis_fft_sample_buffer, SLICE_SIZE * sizeof(gfloat));
-        
-        for (i = 0; i < SLICE_SIZE; i++) {
-            gfloat avg = 0.0f;
+static void
+bp_vis_analysis_free (BansheePlayer *player)
+{
+    if (player->vis_fft != NULL) {
+        gst_fft_f32_free (player->vis_fft);
+        player->vis_fft = NULL;
+    }
 
-            for (j = 0; j < channels; j++) {
-                gfloat sample = data[i * channels + j];
+    g_free (player->vis_fft_buffer);
+    player->vis_fft_buffer = NULL;
+    g_free (player->vis_fft_sample_buffer);
+    player->vis_fft_sample_buffer = NULL;
+    g_free (player->vis_spectrum);
+    player->vis_spectrum = NULL;
+    g_free (player->vis_window);
+    player->vis_window = NULL;
+    g_free (player->vis_mono);
+    player->vis_mono = NULL;
+    g_free (player->vis_band_edges);
+    player->vis_band_edges = NULL;
+    g_free (player->vis_bands);
+    player->vis_bands = NULL;
+    g_free (player->vis_decimate_history);
+    player->vis_decimate_history = NULL;
+    g_free (player->vis_decimate_scratch);
+    player->vis_decimate_scratch = NULL;
+    player->vis_decimate_channels = 0;
+}
 
-                deinterlaced[j * SLICE_SIZE + i] = sample;
-                avg += sample;
-            }
+static void
+bp_vis_apply_config (BansheePlayer *player, gint rate)
+{
+    BpVisConfig *config = &player->vis_applied;
+    gint analysis_rate, fft_size, bins;
+    
+    // Only the worker touches the analysis state, so it picks up a new
+    // configuration or stream rate between slices and nobody else has
+    // to wait for it
+    g_mutex_lock (player->mutex);
+    *config = player->vis_config;
+    player->vis_applied_serial = g_atomic_int_get (&player->vis_config_serial);
+    g_mutex_unlock (player->mutex);
+    
+    bp_vis_analysis_free (player);
+    
+    // The stream is analyzed at its own rate, or a power of two fraction
+    // of it, so the FFT grows with the rate to keep the same resolution in
+    // Hz; rounded up to a size it handles quickly only if asked to
+    player->vis_rate = rate;
+    player->vis_decimation = bp_vis_decimation (config->decimate, rate);
+    analysis_rate = rate / player->vis_decimation;
+    
+    fft_size = bp_vis_scale_to_rate (config->fft_size, analysis_rate);
+    fft_size = CLAMP (fft_size + (fft_size & 1), 64, 65536);
+    player->vis_fft_size = fft_size = config->fast_fft ? _bp_dsp_fft_length (fft_size) : fft_size;
+    player->vis_hop = bp_vis_scale_to_rate (config->hop_size, analysis_rate);
+    
+    bins = fft_size / 2;
+    player->vis_fft = gst_fft_f32_new (fft_size, FALSE);
+    player->vis_fft_buffer = g_new (GstFFTF32Complex, bins + 1);
+    player->vis_fft_sample_buffer = g_new0 (gfloat, fft_size);
+    player->vis_spectrum = g_new (gfloat, fft_size);
+    player->vis_window = _bp_dsp_hamming_new (fft_size);
+    player->vis_mono = g_new (gfloat, player->vis_hop * player->vis_decimation);
+    
+    if (config->bands > 0) {
+        player->vis_band_edges = _bp_dsp_band_edges_new (config->scale, MIN (config->bands, bins), 
+            bins, analysis_rate);
+        player->vis_bands = g_new (gfloat, config->bands);
+    }
+    
+    bp_debug ("Visualization analyzing %d Hz audio at %d Hz, %d point FFT every %d samples",
+        rate, analysis_rate, fft_size, player->vis_hop);
+}
 
-            avg /= channels;
-            specbuf[i + SLICE_SIZE] = avg;
+static void
+bp_vis_analyze (BansheePlayer *player, BpVisSlice *slice)
+{
+    BpVisConfig *config = &player->vis_applied;
+    gfloat *history, *specbuf, *spectrum;
+    gint channels = slice->channels;
+    gint samples = slice->samples;
+    gint fft_size, bins, bands, keep;
+    
+    if (player->vis_applied_serial != g_atomic_int_get (&player->vis_config_serial) || 
+        player->vis_rate != slice->rate) {
+        bp_vis_apply_config (player, slice->rate);
+    }
+    
+    // Cut before the hop size changed; the next one will fit
+    if (samples != player->vis_hop * player->vis_decimation) {
+        g_atomic_int_inc (&player->vis_slices_dropped);
+        return;
+    }
+    
+    fft_size = player->vis_fft_size;
+    bins = fft_size / 2;
+    history = player->vis_fft_sample_buffer;
+    specbuf = player->vis_spectrum;
+    
+    player->vis_deinterlaced = bp_vis_scratch (player, player->vis_deinterlaced, 
+        &player->vis_deinterlaced_size, channels * samples);
+    
+    if (slice->discont) {
+        memset (history, 0, sizeof(gfloat) * fft_size);
+    }
+    
+    // Planar channels for the host, and the mono downmix for the FFT;
+    // see banshee-player-dsp.c
+    _bp_dsp_deinterleave (slice->pcm, player->vis_deinterlaced, player->vis_mono, channels, samples);
+    
+    if (player->vis_decimation > 1) {
+        gint rows = _bp_dsp_decimate_history_length (channels, player->vis_decimation);
+        
+        // The filters run across slices, so their history is only
+        // started over with the stream or the channel layout
+        if (player->vis_decimate_channels != channels) {
+            g_free (player->vis_decimate_history);
+            player->vis_decimate_history = g_new0 (gfloat, rows + 
+                _bp_dsp_decimate_history_length (1, player->vis_decimation));
+            player->vis_decimate_channels = channels;
+            g_atomic_int_inc (&player->vis_allocations);
+        } else if (slice->discont) {
+            memset (player->vis_decimate_history, 0, sizeof (gfloat) * (rows + 
+                _bp_dsp_decimate_history_length (1, player->vis_decimation)));
         }
-
-        memcpy (player->vis_fft_sample_buffer, &specbuf[SLICE_SIZE], SLICE_SIZE * sizeof(gfloat));
-
-        gst_fft_f32_window (player->vis_fft, specbuf, GST_FFT_WINDOW_HAMMING);
-        gst_fft_f32_fft (player->vis_fft, specbuf, player->vis_fft_buffer);
-
-        for (i = 0; i < SLICE_SIZE; i++) {
-            gfloat val;
-
-            GstFFTF32Complex cplx = player->vis_fft_buffer[i];
-
-            val = cplx.r * cplx.r + cplx.i * cplx.i;
-            val /= SLICE_SIZE * SLICE_SIZE;
-            val = 10.0f * log10f(val);
-
-            val = (val + 60.0f) / 60.0f;
-            if (val < 0.0f)
-                val = 0.0f;
-
-            specbuf[i] = val;
+        
+        if (player->vis_decimate_scratch == NULL) {
+            player->vis_decimate_scratch = g_new (gfloat, samples + BP_DSP_DECIMATE_HISTORY);
+            g_atomic_int_inc (&player->vis_allocations);
         }
-
-        vis_data_cb (player, channels, SLICE_SIZE, deinterlaced, SLICE_SIZE, specbuf);
         
-        g_free (deinterlaced);
-        g_free (specbuf);
+        _bp_dsp_decimate (player->vis_deinterlaced, player->vis_decimate_history, 
+            player->vis_decimate_scratch, channels, samples, player->vis_decimation);
+        _bp_dsp_decimate (player->vis_mono, player->vis_decimate_history + rows, 
+            player->vis_decimate_scratch, 1, samples, player->vis_decimation);
+        samples = player->vis_hop;
+    }
+    
+    // Slide the FFT input along by one hop. With the default sizes each
+    // FFT covers the previous slice and this one; a hop longer than the
+    // FFT only keeps its tail
+    keep = MAX (fft_size - samples, 0);
+    memmove (history, history + fft_size - keep, keep * sizeof(gfloat));
+    memcpy (history + keep, player->vis_mono + samples - (fft_size - keep), (fft_size - keep) * sizeof(gfloat));
+    memcpy (specbuf, history, fft_size * sizeof(gfloat));
+
+    _bp_dsp_window (specbuf, player->vis_window, fft_size);
+    gst_fft_f32_fft (player->vis_fft, specbuf, player->vis_fft_buffer);
+    _bp_dsp_power_db (player->vis_fft_buffer, specbuf, bins, 1.0f / ((gfloat)bins * bins));
+    
+    spectrum = specbuf;
+    if (config->bands > 0) {
+        // A low rate stream may have fewer bins than bands; the top
+        // bands just stay dark
+        bands = MIN (config->bands, bins);
+        _bp_dsp_reduce_bands (specbuf, player->vis_band_edges, player->vis_bands, bands);
+        memset (player->vis_bands + bands, 0, (config->bands - bands) * sizeof(gfloat));
+        spectrum = player->vis_bands;
+        bins = config->bands;
+    }
 
-        gst_adapter_flush (player->vis_buffer, wanted_size);
+    // Leaving out the PCM and the unused bins is what saves the host
+    // the marshaling, so only what was asked for crosses over
+    if (config->include_pcm) {
+        _bp_events_emit_vis_data (player, channels, samples, player->vis_deinterlaced, bins, spectrum);
+    } else {
+        _bp_events_emit_vis_data (player, channels, 0, NULL, bins, spectrum);
     }
+    
+    g_atomic_int_inc (&player->vis_slices);
+    
+    _bp_threads_account_analysis (player);
 }
 
-// ---------------------------------------------------------------------------
-// Internal Functions
-// ---------------------------------------------------------------------------
+static gpointer
+bp_vis_worker (BansheePlayer *player)
+{
+    BpVisSlice *slice;
+    
+    g_mutex_lock (player->vis_worker_mutex);
+    
+    while (!player->vis_worker_quit) {
+        if ((slice = bp_vis_ring_newest (player)) == NULL) {
+            g_atomic_int_set (&player->vis_worker_idle, TRUE);
+            
+            // Check again, a slice may have landed before we said so
+            if (bp_vis_ring_newest (player) == NULL) {
+                g_cond_wait (player->vis_worker_cond, player->vis_worker_mutex);
+            }
+            
+            g_atomic_int_set (&player->vis_worker_idle, FALSE);
+            continue;
+        }
+        
+        g_mutex_unlock (player->vis_worker_mutex);
+        
+        bp_vis_analyze (player, slice);
+        g_atomic_int_inc (&player->vis_ring_tail);
+        
+        g_mutex_lock (player->vis_worker_mutex);
+    }
+    
+    g_mutex_unlock (player->vis_worker_mutex);
+    
+    return NULL;
+}
 
 static void
-_bp_vis_pipeline_block_callback (GstPad *pad, gboolean blocked, gpointer data)
+bp_vis_worker_start (BansheePlayer *player)
 {
-    BansheePlayer *player = (BansheePlayer *) data;
-
-    if (!blocked) {
-        // Set thawing mode (discards buffers that are too old from the queue).
-        player->vis_thawing = TRUE;
+    GError *error = NULL;
+    
+    player->vis_worker_mutex = g_mutex_new ();
+    player->vis_worker_cond = g_cond_new ();
+    player->vis_worker_quit = FALSE;
+    player->vis_worker_idle = FALSE;
+    player->vis_applied_serial = g_atomic_int_get (&player->vis_config_serial) - 1;
+    player->vis_rate = 0;
+    player->vis_ring_head = player->vis_ring_tail = 0;
+    player->vis_ring = g_new0 (BpVisSlice, BP_VIS_RING_SIZE);
+    
+    player->vis_worker = g_thread_create ((GThreadFunc)bp_vis_worker, player, TRUE, &error);
+    if (player->vis_worker == NULL) {
+        g_warning ("Could not start the visualization worker: %s", error->message);
+        g_error_free (error);
     }
 }
 
 static void
-_bp_vis_pipeline_set_blocked (BansheePlayer *player, gboolean blocked)
+bp_vis_worker_stop (BansheePlayer *player)
 {
-    GstPad *queue_sink;
+    gint i;
+    
+    if (player->vis_worker != NULL) {
+        g_mutex_lock (player->vis_worker_mutex);
+        player->vis_worker_quit = TRUE;
+        g_cond_signal (player->vis_worker_cond);
+        g_mutex_unlock (player->vis_worker_mutex);
+        
+        g_thread_join (player->vis_worker);
+        player->vis_worker = NULL;
+    }
+    
+    if (player->vis_ring != NULL) {
+        for (i = 0; i < BP_VIS_RING_SIZE; i++) {
+            g_free (player->vis_ring[i].pcm);
+        }
+        
+        g_free (player->vis_ring);
+        player->vis_ring = NULL;
+    }
+    
+    if (player->vis_worker_cond != NULL) {
+        g_cond_free (player->vis_worker_cond);
+        player->vis_worker_cond = NULL;
+    }
+    
+    if (player->vis_worker_mutex != NULL) {
+        g_mutex_free (player->vis_worker_mutex);
+        player->vis_worker_mutex = NULL;
+    }
+}
 
-    if (player->vis_resampler == NULL)
+static void
+bp_vis_pcm_handoff (GstElement *sink, GstBuffer *buffer, GstPad *pad, gpointer userdata)
+{
+    BansheePlayer *player = (BansheePlayer*)userdata;
+    GstStructure *structure;
+    BpVisSlice *slice;
+    gint channels = 0, rate = 0, factor, samples, wanted_size;
+    gfloat *data;
+    
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if ((player->vis_data_cb == NULL && !player->vis_events_enabled) || player->vis_worker == NULL) {
         return;
+    }
 
-    queue_sink = gst_element_get_static_pad (player->vis_resampler, "src");
+    if (player->vis_thawing) {
+        // Flush our buffers out; the worker drops its FFT history
+        // when it gets to the next slice
+        gst_adapter_clear (player->vis_buffer);
+        player->vis_discont = TRUE;
 
-    gst_pad_set_blocked_async (queue_sink, blocked, _bp_vis_pipeline_block_callback, (gpointer) player);
+        player->vis_thawing = FALSE;
+    }
+    
+    // Borrowed; the buffer holds the reference
+    if (GST_BUFFER_CAPS (buffer) == NULL) {
+        return;
+    }
+    
+    structure = gst_caps_get_structure (GST_BUFFER_CAPS (buffer), 0);
+    if (!gst_structure_get_int (structure, "channels", &channels) || channels <= 0 ||
+        !gst_structure_get_int (structure, "rate", &rate) || rate <= 0) {
+        return;
+    }
+    
+    // The same hop the worker will expect at this rate; see bp_vis_apply_config
+    factor = bp_vis_decimation (g_atomic_int_get (&player->vis_decimate), rate);
+    samples = bp_vis_scale_to_rate (g_atomic_int_get (&player->vis_hop_size), rate / factor) * factor;
+    wanted_size = channels * samples * sizeof (gfloat);
 
-    gst_object_unref (GST_OBJECT (queue_sink));
+    // The sink only reads the buffer, so the adapter can share it
+    gst_adapter_push (player->vis_buffer, gst_buffer_ref (buffer));
+    
+    while ((data = (gfloat *)gst_adapter_peek (player->vis_buffer, wanted_size)) != NULL) {
+        if ((slice = bp_vis_ring_reserve (player)) == NULL) {
+            // The worker is behind by a whole ring; this slice is lost
+            g_atomic_int_inc (&player->vis_slices_dropped);
+            player->vis_discont = TRUE;
+        } else {
+            slice->pcm = bp_vis_scratch (player, slice->pcm, &slice->size, channels * samples);
+            memcpy (slice->pcm, data, wanted_size);
+            slice->channels = channels;
+            slice->samples = samples;
+            slice->rate = rate;
+            slice->discont = player->vis_discont;
+            player->vis_discont = FALSE;
+            
+            bp_vis_ring_commit (player);
+        }
+
+        gst_adapter_flush (player->vis_buffer, wanted_size);
+    }
 }
 
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
 static gboolean
 _bp_vis_pipeline_event_probe (GstPad *pad, GstEvent *event, gpointer data)
 {
@@ -173,39 +488,52 @@ _bp_vis_pipeline_event_probe (GstPad *pad, GstEvent *event, gpointer data)
         default: break;
     }
 
-    if (player->vis_enabled)
-        return TRUE;
-
-    switch (GST_EVENT_TYPE (event)) {
-    case GST_EVENT_EOS:
-        _bp_vis_pipeline_set_blocked (player, FALSE);
-        break;
-
-    case GST_EVENT_NEWSEGMENT:
-        _bp_vis_pipeline_set_blocked (player, TRUE);
-        break;
-
-    default: break;
-    }
-
     return TRUE;
 }
 
+void
+_bp_vis_init (BansheePlayer *player)
+{
+    player->vis_config.fft_size = SLICE_SIZE * 2;
+    player->vis_config.hop_size = SLICE_SIZE;
+    player->vis_config.bands = 0;
+    player->vis_config.scale = BP_VIS_BAND_SCALE_LINEAR;
+    player->vis_config.include_pcm = TRUE;
+    player->vis_config.decimate = TRUE;
+    player->vis_config.fast_fft = FALSE;
+    player->vis_hop_size = SLICE_SIZE;
+    player->vis_decimate = TRUE;
+}
+
 void
 _bp_vis_pipeline_setup (BansheePlayer *player)
 {
     // The basic pipeline we're constructing is:
-    // .audiotee ! queue ! audioresample ! audioconvert ! fakesink
-
-    GstElement *fakesink, *converter, *resampler, *audiosinkqueue;
+    // .audiotee ! queue ! audioconvert ! fakesink
+    //
+    // There is no resampler: the stream is analyzed at its own rate, and
+    // hi-res streams are decimated by the worker (see bp_vis_apply_config)
+    //
+    // The elements live in their own bin, which is only linked to the
+    // tee while visualization is enabled (see banshee-player-tee.c)
+
+    GstElement *bin, *fakesink, *converter, *audiosinkqueue;
     GstCaps *caps;
     GstPad *pad;
-    gint wanted_size;
     
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // Built on first use, and at most once per pipeline
+    if (player->audiobin == NULL || player->vis_bin != NULL) {
+        return;
+    }
+    
+    // The FFT and its buffers are sized by the worker from the vis config
     player->vis_buffer = NULL;
-    player->vis_fft = gst_fft_f32_new (SLICE_SIZE * 2, FALSE);
-    player->vis_fft_buffer = g_new (GstFFTF32Complex, SLICE_SIZE + 1);
-    player->vis_fft_sample_buffer = g_new0 (gfloat, SLICE_SIZE);
+    player->vis_deinterlaced = NULL;
+    player->vis_deinterlaced_size = 0;
+    player->vis_discont = TRUE;
+    bp_vis_worker_start (player);
     
     // Core elements, if something fails here, it's the end of the world
     audiosinkqueue = gst_element_factory_make ("queue", "vis-queue");
@@ -214,20 +542,16 @@ _bp_vis_pipeline_setup (BansheePlayer *player)
     gst_pad_add_event_probe (pad, G_CALLBACK (_bp_vis_pipeline_event_probe), player);
     gst_object_unref (GST_OBJECT (pad));
 
-    resampler = gst_element_factory_make ("audioresample", "vis-resample");
     converter = gst_element_factory_make ("audioconvert", "vis-convert");
     fakesink = gst_element_factory_make ("fakesink", "vis-sink");
 
-    // channels * slice size * float size = size of chunks we want
-    wanted_size = 2 * SLICE_SIZE * sizeof(gfloat);
-
-    if (audiosinkqueue == NULL || resampler == NULL || converter == NULL || fakesink == NULL) {
+    if (audiosinkqueue == NULL || converter == NULL || fakesink == NULL) {
         bp_debug ("Could not construct visualization pipeline, a fundamental element could not be created");
         return;
     }
 
-    // Keep around the 5 most recent seconds of audio so that when resuming
-    // visualization we have something to show right away.
+    // Let the branch fall at most 5 seconds behind; older audio is dropped.
+    // The queue only fills while the branch is linked to the tee.
     g_object_set (G_OBJECT (audiosinkqueue),
             "leaky", 2,
             "max-size-buffers", 0,
@@ -252,52 +576,49 @@ _bp_vis_pipeline_setup (BansheePlayer *player)
             // Don't go to PAUSED when we freeze the pipeline.
             "async", FALSE, NULL);
     
-    gst_bin_add_many (GST_BIN (player->audiobin), audiosinkqueue, resampler,
-                      converter, fakesink, NULL);
+    bin = gst_bin_new ("vis-bin");
+    gst_bin_add_many (GST_BIN (bin), audiosinkqueue, converter, fakesink, NULL);
     
     pad = gst_element_get_static_pad (audiosinkqueue, "sink");
-    gst_pad_link (gst_element_get_request_pad (player->audiotee, "src%d"), pad);
+    gst_element_add_pad (bin, gst_ghost_pad_new ("sink", pad));
     gst_object_unref (GST_OBJECT (pad));
     
-    gst_element_link_many (audiosinkqueue, resampler, converter, NULL);
+    gst_element_link (audiosinkqueue, converter);
     
     caps = gst_static_caps_get (&vis_data_sink_caps);
     gst_element_link_filtered (converter, fakesink, caps);
     gst_caps_unref (caps);
     
     player->vis_buffer = gst_adapter_new ();
-    player->vis_resampler = resampler;
+    player->vis_bin = bin;
     player->vis_thawing = FALSE;
     player->vis_enabled = FALSE;
-
-    // Disable the pipeline till we hear otherwise from managed land.
-    _bp_vis_pipeline_set_blocked (player, TRUE);
+    
+    _bp_health_watch_vis_queue (player, audiosinkqueue);
+    _bp_threads_watch_vis_queue (player, audiosinkqueue);
+    
+    // Stays off the tee till we hear otherwise from managed land.
+    bp_tee_add_branch (player, bin, player->vis_data_cb != NULL || player->vis_events_enabled);
 }
 
 void
 _bp_vis_pipeline_destroy (BansheePlayer *player)
 {
+    // The branch is down by now, so nothing is feeding the worker
+    bp_vis_worker_stop (player);
+
     if (player->vis_buffer != NULL) {
         gst_object_unref (player->vis_buffer);
         player->vis_buffer = NULL;
     }
 
-    if (player->vis_fft != NULL) {
-        gst_fft_f32_free (player->vis_fft);
-        player->vis_fft = NULL;
-    }
-
-    if (player->vis_fft_buffer != NULL) {
-        g_free (player->vis_fft_buffer);
-        player->vis_fft_buffer = NULL;
-    }
-
-    if (player->vis_fft_sample_buffer != NULL) {
-        g_free (player->vis_fft_sample_buffer);
-        player->vis_fft_sample_buffer = NULL;
-    }
+    bp_vis_analysis_free (player);
+    g_free (player->vis_deinterlaced);
+    player->vis_deinterlaced = NULL;
+    player->vis_deinterlaced_size = 0;
 
-    player->vis_resampler = NULL;
+    _bp_health_unwatch_vis_queue (player);
+    player->vis_bin = NULL;
     player->vis_enabled = FALSE;
     player->vis_thawing = FALSE;
 }
@@ -314,6 +635,100 @@ bp_set_vis_data_callback (BansheePlayer *player, BansheePlayerVisDataCallback cb
 
     player->vis_data_cb = cb;
 
-    _bp_vis_pipeline_set_blocked (player, cb == NULL);
-    player->vis_enabled = cb != NULL;
+    if (cb != NULL) {
+        _bp_vis_pipeline_setup (player);
+    }
+
+    bp_tee_set_branch_attached (player, player->vis_bin, cb != NULL || player->vis_events_enabled);
+    player->vis_enabled = cb != NULL || player->vis_events_enabled;
+}
+
+P_INVOKE void
+bp_set_vis_events_enabled (BansheePlayer *player, gboolean enabled)
+{
+    // Run the vis pipeline for polled VIS_DATA events without a callback
+    if (player == NULL)
+        return;
+
+    player->vis_events_enabled = enabled;
+
+    if (enabled) {
+        _bp_vis_pipeline_setup (player);
+    }
+
+    bp_tee_set_branch_attached (player, player->vis_bin, player->vis_data_cb != NULL || enabled);
+    player->vis_enabled = player->vis_data_cb != NULL || enabled;
+}
+
+P_INVOKE void
+bp_set_vis_config (BansheePlayer *player, gint fft_size, gint hop_size, gint bands, 
+    BpVisBandScale scale, gboolean include_pcm)
+{
+    // Sizes are in samples at 44.1 kHz and scaled to the rate the stream
+    // is analyzed at (see bp_set_vis_decimation), so with bands = 0 the
+    // spectrum has half the scaled FFT size in bins: 735 at 44.1 kHz and
+    // 800 at 48 kHz with the default 1470 point FFT.
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // The size is kept as given, only made even for gst_fft_f32 (see
+    // bp_set_vis_fast_fft); a hop longer than the FFT skips audio
+    fft_size = CLAMP (fft_size + (fft_size & 1), 64, 16384);
+    hop_size = CLAMP (hop_size, 64, BP_VIS_RATE);
+    bands = CLAMP (bands, 0, fft_size / 2);
+    
+    g_mutex_lock (player->mutex);
+    player->vis_config.fft_size = fft_size;
+    player->vis_config.hop_size = hop_size;
+    player->vis_config.bands = bands;
+    player->vis_config.scale = scale;
+    player->vis_config.include_pcm = include_pcm;
+    g_mutex_unlock (player->mutex);
+    
+    // Slices cut at the old hop size are dropped by the worker when
+    // it sees the new serial
+    g_atomic_int_set (&player->vis_hop_size, hop_size);
+    g_atomic_int_inc (&player->vis_config_serial);
+}
+
+P_INVOKE void
+bp_set_vis_decimation (BansheePlayer *player, gboolean decimate)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // Off analyzes hi-res streams over their whole band, at the cost of
+    // a proportionally bigger FFT
+    g_mutex_lock (player->mutex);
+    player->vis_config.decimate = decimate;
+    g_mutex_unlock (player->mutex);
+    
+    g_atomic_int_set (&player->vis_decimate, decimate);
+    g_atomic_int_inc (&player->vis_config_serial);
+}
+
+P_INVOKE void
+bp_set_vis_fast_fft (BansheePlayer *player, gboolean fast)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // On, FFT sizes are rounded up to the next one kiss_fft handles
+    // quickly (see _bp_dsp_fft_length), which changes the number of
+    // bins; 1470 becomes 1500, for 750 bins instead of 735
+    g_mutex_lock (player->mutex);
+    player->vis_config.fast_fft = fast;
+    g_mutex_unlock (player->mutex);
+    
+    g_atomic_int_inc (&player->vis_config_serial);
+}
+
+P_INVOKE void
+bp_get_vis_stats (BansheePlayer *player, guint64 *slices, guint64 *dropped, guint64 *allocations)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    // Allocations made for the slice ring on the streaming thread and for
+    // the analysis buffers on the worker; in steady state this stays put
+    // while the slice count climbs
+    *slices = (guint)g_atomic_int_get (&player->vis_slices);
+    *dropped = g_atomic_int_get (&player->vis_slices_dropped);
+    *allocations = g_atomic_int_get (&player->vis_allocations);
 }
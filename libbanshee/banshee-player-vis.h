@@ -31,6 +31,7 @@
 
 #include "banshee-player-private.h"
 
+void _bp_vis_init             (BansheePlayer *player);
 void _bp_vis_pipeline_setup   (BansheePlayer *player);
 void _bp_vis_pipeline_destroy (BansheePlayer *player);
 
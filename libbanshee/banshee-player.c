@@ -29,8 +29,31 @@
 #include "banshee-player-private.h"
 #include "banshee-player-pipeline.h"
 #include "banshee-player-cdda.h"
+#include "banshee-player-events.h"
+#include "banshee-player-fade.h"
+#include "banshee-player-latency.h"
 #include "banshee-player-missing-elements.h"
 #include "banshee-player-replaygain.h"
+#include "banshee-player-seek.h"
+#include "banshee-player-state.h"
+#include "banshee-player-suspend.h"
+#include "banshee-player-tags.h"
+#include "banshee-player-vis.h"
+
+typedef struct {
+    BansheePlayer *player;
+    BpAsyncOperation operation;
+    gchar *uri;
+    guint64 position;
+    GstState state;
+    gboolean success;
+    GstClockTime submitted;
+    GstClockTime completed;
+    guint source_id;
+} BpAsyncRequest;
+
+P_INVOKE gboolean bp_set_position (BansheePlayer *player, guint64 time_ms);
+P_INVOKE gboolean bp_set_next_uri (BansheePlayer *player, const gchar *uri);
 
 // ---------------------------------------------------------------------------
 // Private Functions
@@ -41,9 +64,9 @@ bp_iterate_timeout_handler (BansheePlayer *player)
 {
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
     
-    if(player->iterate_cb != NULL) {
-        player->iterate_cb (player);
-    }
+    player->iterate_wakeups++;
+    
+    _bp_events_emit_iterate (player);
     
     return TRUE;
 }
@@ -53,8 +76,20 @@ bp_iterate_timeout_start (BansheePlayer *player)
 {
     g_return_if_fail (IS_BANSHEE_PLAYER(player));
 
-    if (player->iterate_timeout_id == 0) {
-        player->iterate_timeout_id = g_timeout_add (200, 
+    // Nobody is listening, so there is no reason to wake up at all; in
+    // events mode the host polls for ITERATE instead of taking a callback
+    if (player->iterate_timeout_id != 0 || player->iterate_interval == 0 ||
+        (player->iterate_cb == NULL && !player->events_enabled)) {
+        return;
+    }
+    
+    // Whole-second intervals are coalesced with every other seconds
+    // timeout in the process so the main loop wakes up less often
+    if (player->iterate_interval % 1000 == 0) {
+        player->iterate_timeout_id = g_timeout_add_seconds (player->iterate_interval / 1000, 
+            (GSourceFunc)bp_iterate_timeout_handler, player);
+    } else {
+        player->iterate_timeout_id = g_timeout_add (player->iterate_interval, 
             (GSourceFunc)bp_iterate_timeout_handler, player);
     }
 }
@@ -89,6 +124,320 @@ bp_pipeline_set_state (BansheePlayer *player, GstState state)
     }
 }
 
+static GstState
+bp_stop_state (BansheePlayer *player, gboolean nullstate)
+{
+    // Some times "stop" really means "pause", particularly with
+    // CDDA track transitioning; a NULL state will release resources
+    GstState state = nullstate ? GST_STATE_NULL : GST_STATE_PAUSED;
+    
+    if (!nullstate && player->cdda_device == NULL) {
+        // only allow going to PAUSED if we're playing CDDA
+        state = GST_STATE_NULL;
+    }
+    
+    return state;
+}
+
+static void
+bp_async_request_free (BpAsyncRequest *request)
+{
+    g_free (request->uri);
+    g_free (request);
+}
+
+static gboolean
+bp_async_wait_for_state (BansheePlayer *player)
+{
+    GstStateChangeReturn result;
+    GstElement *playbin = NULL;
+    
+    bp_pipeline_lock (player);
+    if (player->playbin != NULL) {
+        playbin = gst_object_ref (player->playbin);
+    }
+    bp_pipeline_unlock (player);
+    
+    if (playbin == NULL) {
+        return FALSE;
+    }
+    
+    // Waited for outside the pipeline lock, so the main loop can carry on
+    // meanwhile; bounded so a stalled source can't wedge the worker forever
+    result = gst_element_get_state (playbin, NULL, NULL, 10 * GST_SECOND);
+    gst_object_unref (playbin);
+    
+    // Still ASYNC means we gave up waiting; that is not a success
+    if (result == GST_STATE_CHANGE_ASYNC) {
+        bp_debug ("Timed out waiting for the pipeline to change state");
+    }
+    
+    return result == GST_STATE_CHANGE_SUCCESS || result == GST_STATE_CHANGE_NO_PREROLL;
+}
+
+static void
+bp_async_process (BpAsyncRequest *request)
+{
+    BansheePlayer *player = request->player;
+    
+    switch (request->operation) {
+        case BP_ASYNC_OPEN:
+            // The pipeline was built on the caller's thread; a NULL uri
+            // means the CDDA code already took the request there
+            request->success = TRUE;
+            if (request->uri != NULL) {
+                bp_pipeline_lock (player);
+                request->success = bp_open_load (player, request->uri);
+                bp_pipeline_unlock (player);
+            }
+            break;
+            
+        case BP_ASYNC_PLAY:
+        case BP_ASYNC_PAUSE:
+        case BP_ASYNC_STOP:
+            bp_pipeline_lock (player);
+            if (player->playbin != NULL) {
+                player->target_state = request->state;
+                request->success = gst_element_set_state (player->playbin, request->state) 
+                    != GST_STATE_CHANGE_FAILURE;
+            }
+            bp_pipeline_unlock (player);
+            
+            request->success = request->success && bp_async_wait_for_state (player);
+            break;
+            
+        case BP_ASYNC_SEEK:
+            request->success = bp_set_position (player, request->position) && 
+                bp_async_wait_for_state (player);
+            break;
+            
+        default: 
+            break;
+    }
+}
+
+static gboolean
+bp_async_complete (BpAsyncRequest *request)
+{
+    BansheePlayer *player = request->player;
+    
+    g_mutex_lock (player->mutex);
+    player->async_pending = g_slist_remove (player->async_pending, request);
+    g_mutex_unlock (player->mutex);
+    
+    // Timeouts belong to the main loop, so they are only touched here
+    if (request->operation == BP_ASYNC_PLAY && request->success) {
+        bp_iterate_timeout_start (player);
+    }
+    
+    _bp_events_emit_async_done (player, request->operation, request->success, 
+        (request->completed - request->submitted) / GST_USECOND);
+    
+    bp_async_request_free (request);
+    return FALSE;
+}
+
+static gpointer
+bp_async_worker (BansheePlayer *player)
+{
+    BpAsyncRequest *request;
+    
+    while ((request = g_async_queue_pop (player->async_queue)) != NULL) {
+        if (request->operation == BP_ASYNC_QUIT) {
+            bp_async_request_free (request);
+            break;
+        }
+        
+        bp_async_process (request);
+        request->completed = gst_util_get_timestamp ();
+        
+        bp_debug ("Asynchronous request %d finished in %" G_GUINT64_FORMAT " us (%s)", 
+            request->operation, (request->completed - request->submitted) / GST_USECOND,
+            request->success ? "success" : "failure");
+        
+        g_mutex_lock (player->mutex);
+        player->async_pending = g_slist_prepend (player->async_pending, request);
+        request->source_id = g_idle_add ((GSourceFunc)bp_async_complete, request);
+        g_mutex_unlock (player->mutex);
+    }
+    
+    return NULL;
+}
+
+static gboolean
+bp_async_push (BansheePlayer *player, BpAsyncOperation operation, const gchar *uri, 
+    guint64 position, GstState state)
+{
+    BpAsyncRequest *request;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    if (player->async_thread == NULL) {
+        GError *error = NULL;
+        
+        player->async_queue = g_async_queue_new ();
+        player->async_thread = g_thread_create ((GThreadFunc)bp_async_worker, player, TRUE, &error);
+        
+        if (player->async_thread == NULL) {
+            g_warning ("Could not start asynchronous player worker: %s", error->message);
+            g_error_free (error);
+            g_async_queue_unref (player->async_queue);
+            player->async_queue = NULL;
+            return FALSE;
+        }
+    }
+    
+    request = g_new0 (BpAsyncRequest, 1);
+    request->player = player;
+    request->operation = operation;
+    request->uri = g_strdup (uri);
+    request->position = position;
+    request->state = state;
+    request->submitted = gst_util_get_timestamp ();
+    
+    g_async_queue_push (player->async_queue, request);
+    
+    return TRUE;
+}
+
+static void
+bp_async_shutdown (BansheePlayer *player)
+{
+    BpAsyncRequest *request;
+    GSList *node;
+    
+    if (player->async_thread == NULL) {
+        return;
+    }
+    
+    bp_async_push (player, BP_ASYNC_QUIT, NULL, 0, GST_STATE_VOID_PENDING);
+    g_thread_join (player->async_thread);
+    player->async_thread = NULL;
+    
+    // Drop completions that never made it back to the main loop
+    for (node = player->async_pending; node != NULL; node = node->next) {
+        request = (BpAsyncRequest *)node->data;
+        g_source_remove (request->source_id);
+        bp_async_request_free (request);
+    }
+    
+    g_slist_free (player->async_pending);
+    player->async_pending = NULL;
+    
+    while ((request = g_async_queue_try_pop (player->async_queue)) != NULL) {
+        bp_async_request_free (request);
+    }
+    
+    g_async_queue_unref (player->async_queue);
+    player->async_queue = NULL;
+}
+
+static gboolean
+bp_open_prepare (BansheePlayer *player, const gchar *uri, gboolean *handled)
+{
+    *handled = FALSE;
+    
+    // Build the pipeline if we need to
+    if (player->playbin == NULL && !_bp_pipeline_construct (player)) {
+        return FALSE;
+    }
+    
+    // An explicit open replaces any track queued for a gapless transition
+    bp_set_next_uri (player, NULL);
+    g_atomic_int_set (&player->next_track_pending, FALSE);
+    _bp_fade_reset (player);
+    _bp_tags_reset (player);
+    _bp_seek_reset (player);
+    _bp_suspend_reset (player);
+    _bp_latency_arm (player, BP_LATENCY_STARTUP, TRUE);
+
+    // Give the CDDA code a chance to intercept the open request
+    // in case it is able to perform a fast seek to a track
+    if (_bp_cdda_handle_uri (player, uri)) {
+        *handled = TRUE;
+        return TRUE;
+    }
+    
+    return player->playbin != NULL;
+}
+
+static gboolean
+bp_open_load (BansheePlayer *player, const gchar *uri)
+{
+    GstState state;
+    
+    if (player->playbin == NULL) {
+        return FALSE;
+    }
+    
+    // Set the pipeline to the proper state; leaving PAUSED waits for the
+    // streaming threads, which is the part of an open that can block
+    gst_element_get_state (player->playbin, &state, NULL, 0);
+    if (state >= GST_STATE_PAUSED) {
+        player->target_state = GST_STATE_READY;
+        gst_element_set_state (player->playbin, GST_STATE_READY);
+    }
+    
+    // Pass the request off to playbin
+    g_object_set (G_OBJECT (player->playbin), "uri", uri, NULL);
+    
+    return TRUE;
+}
+
+static gboolean
+bp_open_unlocked (BansheePlayer *player, const gchar *uri)
+{
+    gboolean handled;
+    
+    if (!bp_open_prepare (player, uri, &handled)) {
+        return FALSE;
+    }
+    
+    return handled || bp_open_load (player, uri);
+}
+
+static void
+bp_play_unlocked (BansheePlayer *player)
+{
+    BpStateSnapshot snapshot;
+    
+    // Playing a suspended player resumes it, and it goes on to PLAYING
+    if (player->suspend_phase != BP_SUSPEND_NONE) {
+        player->suspend_state = GST_STATE_PLAYING;
+        bp_resume (player);
+        return;
+    }
+    
+    // Resuming from PAUSED says nothing about startup time
+    _bp_state_get_snapshot (player, &snapshot);
+    if (snapshot.state < GST_STATE_PAUSED) {
+        _bp_latency_arm (player, BP_LATENCY_STARTUP, FALSE);
+    } else if (snapshot.state == GST_STATE_PAUSED) {
+        _bp_latency_arm (player, BP_LATENCY_UNPAUSE, TRUE);
+    }
+    
+    bp_pipeline_set_state (player, GST_STATE_PLAYING);
+}
+
+// ---------------------------------------------------------------------------
+// Internal Functions
+// ---------------------------------------------------------------------------
+
+void
+_bp_iterate_timeout_restart (BansheePlayer *player)
+{
+    // Picks up a change of interval or listeners while playing
+    if (player->iterate_timeout_id == 0 && player->target_state != GST_STATE_PLAYING) {
+        return;
+    }
+    
+    bp_iterate_timeout_stop (player);
+    
+    if (player->target_state == GST_STATE_PLAYING) {
+        bp_iterate_timeout_start (player);
+    }
+}
+
 // ---------------------------------------------------------------------------
 // Public Functions
 // ---------------------------------------------------------------------------
@@ -98,17 +447,36 @@ bp_destroy (BansheePlayer *player)
 {
     g_return_if_fail (IS_BANSHEE_PLAYER (player));
     
-    if (player->mutex != NULL) {
-        g_mutex_free (player->mutex);
-    }
+    bp_async_shutdown (player);
     
     if (player->cdda_device != NULL) {
         g_free (player->cdda_device);
     }
     
+    bp_pipeline_lock (player);
     _bp_pipeline_destroy (player);
+    bp_pipeline_unlock (player);
+    _bp_pipeline_bus_thread_shutdown (player);
+    _bp_tags_destroy (player);
+    _bp_events_destroy (player);
+    
+    if (player->next_uri != NULL) {
+        g_free (player->next_uri);
+    }
+    
     _bp_missing_elements_destroy (player);
     
+    // The pipeline teardown still takes the mutexes, so they go last
+    if (player->tee_mutex != NULL) {
+        g_mutex_free (player->tee_mutex);
+    }
+    
+    if (player->mutex != NULL) {
+        g_mutex_free (player->mutex);
+    }
+    
+    g_static_rec_mutex_free (&player->pipeline_mutex);
+    
     memset (player, 0, sizeof (BansheePlayer));
     
     g_free (player);
@@ -123,8 +491,13 @@ bp_new ()
     BansheePlayer *player = g_new0 (BansheePlayer, 1);
     
     player->mutex = g_mutex_new ();
+    player->tee_mutex = g_mutex_new ();
+    g_static_rec_mutex_init (&player->pipeline_mutex);
+    player->iterate_interval = 200;
+    player->latency_profile = BP_LATENCY_PROFILE_DEFAULT;
     
     _bp_replaygain_init (player); 
+    _bp_vis_init (player);
     
     return player;
 }
@@ -132,123 +505,234 @@ bp_new ()
 P_INVOKE gboolean
 bp_initialize_pipeline (BansheePlayer *player)
 {
-    return _bp_pipeline_construct (player);
+    GTimer *timer;
+    gboolean constructed;
+    
+    // GStreamer may still be loading its registry in the background
+    banshee_wait_initialized ();
+    
+    timer = g_timer_new ();
+    constructed = _bp_pipeline_construct (player);
+    banshee_record_init_time (BANSHEE_INIT_PHASE_PIPELINE, timer);
+    g_timer_destroy (timer);
+    
+    return constructed;
 }
 
 P_INVOKE gboolean
-bp_open (BansheePlayer *player, const gchar *uri)
+bp_set_next_uri (BansheePlayer *player, const gchar *uri)
 {
-    GstState state;
+    gboolean queued = FALSE;
     
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
     
-    // Build the pipeline if we need to
-    if (player->playbin == NULL && !_bp_pipeline_construct (player)) {
-        return FALSE;
+    g_mutex_lock (player->mutex);
+    g_free (player->next_uri);
+    player->next_uri = NULL;
+    
+    #ifdef ENABLE_GAPLESS
+    // CDDA transitions are already handled by seeking on the open device
+    if (uri != NULL && !g_str_has_prefix (uri, "cdda://")) {
+        player->next_uri = g_strdup (uri);
+        queued = TRUE;
     }
+    #endif
+    
+    g_mutex_unlock (player->mutex);
+    
+    return queued || uri == NULL;
+}
 
-    // Give the CDDA code a chance to intercept the open request
-    // in case it is able to perform a fast seek to a track
-    if (_bp_cdda_handle_uri (player, uri)) {
-        return TRUE;
-    } else if (player->playbin == NULL) {
-        return FALSE;
-    }
+P_INVOKE gboolean
+bp_open (BansheePlayer *player, const gchar *uri)
+{
+    gboolean opened;
     
-    // Set the pipeline to the proper state
-    gst_element_get_state (player->playbin, &state, NULL, 0);
-    if (state >= GST_STATE_PAUSED) {
-        player->target_state = GST_STATE_READY;
-        gst_element_set_state (player->playbin, GST_STATE_READY);
-    }
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
     
-    // Pass the request off to playbin
-    g_object_set (G_OBJECT (player->playbin), "uri", uri, NULL);
+    bp_pipeline_lock (player);
+    opened = bp_open_unlocked (player, uri);
+    bp_pipeline_unlock (player);
     
+    return opened;
+}
+
+P_INVOKE gboolean
+bp_supports_gapless (BansheePlayer *player)
+{
+    #ifdef ENABLE_GAPLESS
     return TRUE;
+    #else
+    return FALSE;
+    #endif
+}
+
+P_INVOKE gint64
+bp_get_transition_gap (BansheePlayer *player)
+{
+    gint64 gap;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
+    
+    g_mutex_lock (player->mutex);
+    gap = player->transition_gap;
+    g_mutex_unlock (player->mutex);
+    
+    return gap;
 }
 
 P_INVOKE void
 bp_stop (BansheePlayer *player, gboolean nullstate)
 {
-    // Some times "stop" really means "pause", particularly with
-    // CDDA track transitioning; a NULL state will release resources
-    GstState state = nullstate ? GST_STATE_NULL : GST_STATE_PAUSED;
-    
-    if (!nullstate && player->cdda_device == NULL) {
-        // only allow going to PAUSED if we're playing CDDA
-        state = GST_STATE_NULL;
-    }
+    GstState state = bp_stop_state (player, nullstate);
     
     bp_debug ("bp_stop: setting state to %s", 
         state == GST_STATE_NULL ? "GST_STATE_NULL" : "GST_STATE_PAUSED");
     
+    bp_pipeline_lock (player);
+    _bp_suspend_reset (player);
     bp_pipeline_set_state (player, state);
+    bp_pipeline_unlock (player);
 }
 
 P_INVOKE void
 bp_pause (BansheePlayer *player)
 {
-    bp_pipeline_set_state (player, GST_STATE_PAUSED);
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    bp_pipeline_lock (player);
+    
+    // Pausing a suspended player only changes what it resumes to
+    if (player->suspend_phase != BP_SUSPEND_NONE) {
+        player->suspend_state = GST_STATE_PAUSED;
+    } else {
+        bp_pipeline_set_state (player, GST_STATE_PAUSED);
+    }
+    
+    bp_pipeline_unlock (player);
 }
 
 P_INVOKE void
 bp_play (BansheePlayer *player)
 {
-    bp_pipeline_set_state (player, GST_STATE_PLAYING);
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    bp_pipeline_lock (player);
+    bp_play_unlocked (player);
+    bp_pipeline_unlock (player);
 }
 
 P_INVOKE gboolean
 bp_set_position (BansheePlayer *player, guint64 time_ms)
 {
+    gboolean scheduled = TRUE;
+    
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    bp_pipeline_lock (player);
+    
+    if (!_bp_suspend_set_position (player, time_ms)) {
+        // A seek coalesced into one still in flight is measured from the
+        // first request, which is when the user started waiting
+        _bp_latency_arm (player, BP_LATENCY_SEEK, FALSE);
+        
+        // Coalesced with any seek still in flight, see banshee-player-seek.c
+        scheduled = _bp_seek_schedule (player, time_ms);
+        if (!scheduled) {
+            _bp_latency_disarm (player, BP_LATENCY_SEEK);
+        }
+    }
+    
+    bp_pipeline_unlock (player);
+    
+    return scheduled;
+}
+
+P_INVOKE gboolean
+bp_open_async (BansheePlayer *player, const gchar *uri)
+{
+    gboolean prepared, handled;
+    
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
     
-    if (player->playbin == NULL || !gst_element_seek (player->playbin, 1.0, 
-        GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH,
-        GST_SEEK_TYPE_SET, time_ms * GST_MSECOND, 
-        GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE)) {
-        g_warning ("Could not seek in stream");
+    // Elements and bus sources belong to the thread that owns the player,
+    // so only the state change that can block is left to the worker
+    bp_pipeline_lock (player);
+    prepared = bp_open_prepare (player, uri, &handled);
+    bp_pipeline_unlock (player);
+    
+    if (!prepared) {
         return FALSE;
     }
     
-    return TRUE;
+    return bp_async_push (player, BP_ASYNC_OPEN, handled ? NULL : uri, 0, GST_STATE_VOID_PENDING);
+}
+
+P_INVOKE gboolean
+bp_play_async (BansheePlayer *player)
+{
+    return bp_async_push (player, BP_ASYNC_PLAY, NULL, 0, GST_STATE_PLAYING);
+}
+
+P_INVOKE gboolean
+bp_pause_async (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    bp_iterate_timeout_stop (player);
+    return bp_async_push (player, BP_ASYNC_PAUSE, NULL, 0, GST_STATE_PAUSED);
+}
+
+P_INVOKE gboolean
+bp_stop_async (BansheePlayer *player, gboolean nullstate)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
+    
+    bp_iterate_timeout_stop (player);
+    return bp_async_push (player, BP_ASYNC_STOP, NULL, 0, bp_stop_state (player, nullstate));
+}
+
+P_INVOKE gboolean
+bp_set_position_async (BansheePlayer *player, guint64 time_ms)
+{
+    return bp_async_push (player, BP_ASYNC_SEEK, NULL, time_ms, GST_STATE_VOID_PENDING);
 }
 
 P_INVOKE guint64
 bp_get_position (BansheePlayer *player)
 {
-    static GstFormat format = GST_FORMAT_TIME;
-    gint64 position;
+    BpStateSnapshot snapshot;
 
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
 
-    if (player->playbin != NULL && gst_element_query_position (player->playbin, &format, &position)) {
-        return position / GST_MSECOND;
+    if (player->playbin == NULL) {
+        return 0;
     }
     
-    return 0;
+    // Also covers a suspended player, see _bp_state_set_suspended
+    _bp_state_get_snapshot (player, &snapshot);
+    return snapshot.position;
 }
 
 P_INVOKE guint64
 bp_get_duration (BansheePlayer *player)
 {
-    static GstFormat format = GST_FORMAT_TIME;
-    gint64 duration;
+    BpStateSnapshot snapshot;
 
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
 
-    if (player->playbin != NULL && gst_element_query_duration (player->playbin, &format, &duration)) {
-        return duration / GST_MSECOND;
+    if (player->playbin == NULL) {
+        return 0;
     }
     
-    return 0;
+    _bp_state_get_snapshot (player, &snapshot);
+    return snapshot.duration;
 }
 
 P_INVOKE gboolean
 bp_can_seek (BansheePlayer *player)
 {
-    GstQuery *query;
-    gboolean can_seek = TRUE;
+    BpStateSnapshot snapshot;
     
     g_return_val_if_fail (IS_BANSHEE_PLAYER (player), FALSE);
     
@@ -256,19 +740,8 @@ bp_can_seek (BansheePlayer *player)
         return FALSE;
     }
     
-    query = gst_query_new_seeking (GST_FORMAT_TIME);
-    if (!gst_element_query (player->playbin, query)) {
-        // This will probably fail, 100% of the time, because it's apparently 
-        // very unimplemented in GStreamer... when it's fixed
-        // we will return FALSE here, and show the warning
-        // g_warning ("Could not query pipeline for seek ability");
-        return bp_get_duration (player) > 0;
-    }
-    
-    gst_query_parse_seeking (query, NULL, &can_seek, NULL, NULL);
-    gst_query_unref (query);
-    
-    return can_seek && bp_get_duration (player) > 0;
+    _bp_state_get_snapshot (player, &snapshot);
+    return snapshot.can_seek;
 }
 
 P_INVOKE void
@@ -322,10 +795,50 @@ bp_set_state_changed_callback (BansheePlayer *player, BansheePlayerStateChangedC
     SET_CALLBACK (state_changed_cb);
 }
 
+P_INVOKE void
+bp_set_element_state_changed_callback (BansheePlayer *player, BansheePlayerElementStateChangedCallback cb)
+{
+    // Diagnostics only; every element in the pipeline reports through this
+    SET_CALLBACK (element_state_changed_cb);
+}
+
 P_INVOKE void
 bp_set_iterate_callback (BansheePlayer *player, BansheePlayerIterateCallback cb)
 {
     SET_CALLBACK (iterate_cb);
+    
+    if (player != NULL) {
+        _bp_iterate_timeout_restart (player);
+    }
+}
+
+P_INVOKE void
+bp_set_iterate_interval (BansheePlayer *player, guint interval_ms)
+{
+    g_return_if_fail (IS_BANSHEE_PLAYER (player));
+    
+    if (player->iterate_interval == interval_ms) {
+        return;
+    }
+    
+    // An interval of 0 disables the timer; iterate then only
+    // fires for real events (preroll, seeks, track changes)
+    player->iterate_interval = interval_ms;
+    _bp_iterate_timeout_restart (player);
+}
+
+P_INVOKE guint
+bp_get_iterate_interval (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
+    return player->iterate_interval;
+}
+
+P_INVOKE guint64
+bp_get_iterate_wakeups (BansheePlayer *player)
+{
+    g_return_val_if_fail (IS_BANSHEE_PLAYER (player), 0);
+    return player->iterate_wakeups;
 }
 
 P_INVOKE void
@@ -340,6 +853,24 @@ bp_set_tag_found_callback (BansheePlayer *player, BansheePlayerTagFoundCallback
     SET_CALLBACK (tag_found_cb);
 }
 
+P_INVOKE void
+bp_set_about_to_finish_callback (BansheePlayer *player, BansheePlayerAboutToFinishCallback cb)
+{
+    SET_CALLBACK (about_to_finish_cb);
+}
+
+P_INVOKE void
+bp_set_next_track_starting_callback (BansheePlayer *player, BansheePlayerNextTrackStartingCallback cb)
+{
+    SET_CALLBACK (next_track_starting_cb);
+}
+
+P_INVOKE void
+bp_set_async_done_callback (BansheePlayer *player, BansheePlayerAsyncDoneCallback cb)
+{
+    SET_CALLBACK (async_done_cb);
+}
+
 P_INVOKE void
 bp_get_error_quarks (GQuark *core, GQuark *library, GQuark *resource, GQuark *stream)
 {
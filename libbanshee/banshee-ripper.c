@@ -262,6 +262,8 @@ br_pipeline_construct (BansheeRipper *ripper)
     GError *error = NULL;
     
     g_return_val_if_fail (ripper != NULL, FALSE);
+    
+    banshee_wait_initialized ();
         
     ripper->pipeline = gst_pipeline_new ("pipeline");
     if (ripper->pipeline == NULL) {
@@ -32,6 +32,7 @@
 
 #include <glib/gstdio.h>
 
+#include "banshee-gst.h"
 #include "banshee-tagger.h"
 
 // ---------------------------------------------------------------------------
@@ -69,6 +70,7 @@ bt_tag_list_foreach (const GstTagList *list, const gchar *tag, gpointer userdata
 GstTagList *
 bt_tag_list_new ()
 {
+    banshee_wait_initialized ();
     return gst_tag_list_new ();
 }
 
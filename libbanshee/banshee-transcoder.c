@@ -33,6 +33,8 @@
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
 
+#include "banshee-gst.h"
+
 typedef struct GstTranscoder GstTranscoder;
 
 typedef void (* GstTranscoderProgressCallback) (GstTranscoder *transcoder, gdouble progress);
@@ -233,6 +235,8 @@ gst_transcoder_create_pipeline(GstTranscoder *transcoder,
         return FALSE;
     }
     
+    banshee_wait_initialized();
+    
     transcoder->pipeline = gst_pipeline_new("pipeline");
 
     source_elem = gst_element_factory_make("filesrc", "source");
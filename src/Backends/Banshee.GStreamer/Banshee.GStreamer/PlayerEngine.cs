@@ -28,6 +28,7 @@
 
 using System;
 using System.Collections;
+using System.Collections.Generic;
 using System.Runtime.InteropServices;
 using Mono.Unix;
 using Hyena;
@@ -59,10 +60,34 @@ namespace Banshee.GStreamer
     internal delegate void BansheePlayerVisDataCallback (IntPtr player, int channels, int samples, IntPtr data, int bands, IntPtr spectrum);
     internal delegate IntPtr VideoPipelineSetupHandler (IntPtr player, IntPtr bus);
 
-    internal delegate void GstTaggerTagFoundCallback (IntPtr player, string tagName, ref GLib.Value value);
+    internal delegate void BansheePlayerTagsFoundCallback (IntPtr player, IntPtr tags, int count);
+
+    internal enum BpTagType
+    {
+        None = 0,
+        Int,
+        UInt,
+        Int64,
+        UInt64,
+        Boolean,
+        Double,
+        String,
+        Date
+    }
+
+    [StructLayout (LayoutKind.Sequential)]
+    internal struct BpTag
+    {
+        public long IntValue;
+        public double DoubleValue;
+        public IntPtr Name;
+        public IntPtr StringValue;
+        public uint Quark;
+        public BpTagType Type;
+    }
 
     public class PlayerEngine : Banshee.MediaEngine.PlayerEngine,
-        IEqualizer, IVisualizationDataSource, ISupportClutter
+        IEqualizer, IVisualizationDataSource, IVisualizationConfigurable, ISupportClutter
     {
         private uint GST_CORE_ERROR = 0;
         private uint GST_LIBRARY_ERROR = 0;
@@ -78,7 +103,9 @@ namespace Banshee.GStreamer
         private BansheePlayerBufferingCallback buffering_callback;
         private BansheePlayerVisDataCallback vis_data_callback;
         private VideoPipelineSetupHandler video_pipeline_setup_callback;
-        private GstTaggerTagFoundCallback tag_found_callback;
+        private BansheePlayerTagsFoundCallback tags_found_callback;
+        private Dictionary<uint, string> tag_names = new Dictionary<uint, string> ();
+        private static readonly int tag_size = Marshal.SizeOf (typeof (BpTag));
 
         private bool buffering_finished;
         private int pending_volume = -1;
@@ -109,6 +136,12 @@ namespace Banshee.GStreamer
             }
         }
 
+        public void SetVisualizationConfig (int fftSize, int hopSize, int bands,
+            VisualizationBandScale scale, bool includePcm)
+        {
+            bp_set_vis_config (handle, fftSize, hopSize, bands, (int)scale, includePcm);
+        }
+
         protected override bool DelayedInitialize {
             get { return true; }
         }
@@ -134,14 +167,14 @@ namespace Banshee.GStreamer
             buffering_callback = new BansheePlayerBufferingCallback (OnBuffering);
             vis_data_callback = new BansheePlayerVisDataCallback (OnVisualizationData);
             video_pipeline_setup_callback = new VideoPipelineSetupHandler (OnVideoPipelineSetup);
-            tag_found_callback = new GstTaggerTagFoundCallback (OnTagFound);
+            tags_found_callback = new BansheePlayerTagsFoundCallback (OnTagsFound);
 
             bp_set_eos_callback (handle, eos_callback);
             bp_set_iterate_callback (handle, iterate_callback);
             bp_set_error_callback (handle, error_callback);
             bp_set_state_changed_callback (handle, state_changed_callback);
             bp_set_buffering_callback (handle, buffering_callback);
-            bp_set_tag_found_callback (handle, tag_found_callback);
+            bp_set_tags_found_callback (handle, tags_found_callback);
             bp_set_video_pipeline_setup_callback (handle, video_pipeline_setup_callback);
         }
 
@@ -320,9 +353,12 @@ namespace Banshee.GStreamer
             OnEventChanged (new PlayerEventBufferingArgs ((double) progress / 100.0));
         }
 
-        private void OnTagFound (IntPtr player, string tagName, ref GLib.Value value)
+        private void OnTagsFound (IntPtr player, IntPtr tags, int count)
         {
-            OnTagFound (ProcessNativeTagResult (tagName, ref value));
+            for (int i = 0; i < count; i++) {
+                BpTag tag = (BpTag)Marshal.PtrToStructure (new IntPtr (tags.ToInt64 () + i * tag_size), typeof (BpTag));
+                OnTagFound (ProcessNativeTagResult (tag));
+            }
         }
 
         private void OnVisualizationData (IntPtr player, int channels, int samples, IntPtr data, int bands, IntPtr spectrum)
@@ -334,7 +370,9 @@ namespace Banshee.GStreamer
             }
 
             float [] flat = new float[channels * samples];
-            Marshal.Copy (data, flat, 0, flat.Length);
+            if (flat.Length > 0) {
+                Marshal.Copy (data, flat, 0, flat.Length);
+            }
 
             float [][] cbd = new float[channels][];
             for (int i = 0; i < channels; i++) {
@@ -353,26 +391,40 @@ namespace Banshee.GStreamer
             }
         }
 
-        private static StreamTag ProcessNativeTagResult (string tagName, ref GLib.Value valueRaw)
+        private StreamTag ProcessNativeTagResult (BpTag tag)
         {
-            if (tagName == String.Empty || tagName == null) {
-                return StreamTag.Zero;
-            }
-
             object value = null;
 
-            try {
-                value = valueRaw.Val;
-            } catch {
-                return StreamTag.Zero;
+            switch (tag.Type) {
+                case BpTagType.Int: value = (int)tag.IntValue; break;
+                case BpTagType.UInt: value = (uint)tag.IntValue; break;
+                case BpTagType.Int64: value = tag.IntValue; break;
+                case BpTagType.UInt64: value = (ulong)tag.IntValue; break;
+                case BpTagType.Boolean: value = tag.IntValue != 0; break;
+                case BpTagType.Double: value = tag.DoubleValue; break;
+                case BpTagType.String: value = GLib.Marshaller.Utf8PtrToString (tag.StringValue); break;
+                // A julian day, with day 1 being January 1st of year 1
+                case BpTagType.Date: value = DateTime.MinValue.AddDays (tag.IntValue - 1); break;
             }
 
             if (value == null) {
                 return StreamTag.Zero;
             }
 
+            // Tag names are interned on the native side, so only
+            // marshal each one the first time its quark shows up
+            string name;
+            if (!tag_names.TryGetValue (tag.Quark, out name)) {
+                name = GLib.Marshaller.Utf8PtrToString (tag.Name);
+                tag_names[tag.Quark] = name;
+            }
+
+            if (String.IsNullOrEmpty (name)) {
+                return StreamTag.Zero;
+            }
+
             StreamTag item;
-            item.Name = tagName;
+            item.Name = name;
             item.Value = value;
 
             return item;
@@ -596,6 +648,10 @@ namespace Banshee.GStreamer
         [DllImport ("libbanshee.dll")]
         private static extern void bp_set_vis_data_callback (HandleRef player, BansheePlayerVisDataCallback cb);
 
+        [DllImport ("libbanshee.dll")]
+        private static extern void bp_set_vis_config (HandleRef player, int fft_size, int hop_size,
+            int bands, int scale, bool include_pcm);
+
         [DllImport ("libbanshee.dll")]
         private static extern void bp_set_state_changed_callback (HandleRef player,
             BansheePlayerStateChangedCallback cb);
@@ -613,8 +669,8 @@ namespace Banshee.GStreamer
             VideoPipelineSetupHandler cb);
 
         [DllImport ("libbanshee.dll")]
-        private static extern void bp_set_tag_found_callback (HandleRef player,
-            GstTaggerTagFoundCallback cb);
+        private static extern void bp_set_tags_found_callback (HandleRef player,
+            BansheePlayerTagsFoundCallback cb);
 
         [DllImport ("libbanshee.dll")]
         private static extern bool bp_open (HandleRef player, IntPtr uri);
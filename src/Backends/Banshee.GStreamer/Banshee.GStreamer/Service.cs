@@ -49,7 +49,7 @@ namespace Banshee.GStreamer
         }
 
         [DllImport ("libbanshee.dll")]
-        private static extern void gstreamer_initialize (bool debugging, BansheeLogHandler log_handler);
+        private static extern void gstreamer_initialize_async (bool debugging, BansheeLogHandler log_handler);
 
         void IExtensionService.Initialize ()
         {
@@ -79,7 +79,9 @@ namespace Banshee.GStreamer
                 Console.WriteLine ("GST_PLUGIN_PATH = {0}", System.Environment.GetEnvironmentVariable ("GST_PLUGIN_PATH"));
             }
 
-            gstreamer_initialize (debugging, native_log_handler);
+            // The registry loads in the background; libbanshee waits for it
+            // before building any pipeline
+            gstreamer_initialize_async (debugging, native_log_handler);
 
             ServiceManager.MediaProfileManager.Initialized += OnMediaProfileManagerInitialized;
         }
@@ -29,6 +29,8 @@ using System;
 
 namespace Banshee.MediaEngine
 {
+    // Unless configured otherwise, spectrum holds half a 1470 sample FFT
+    // scaled to the stream rate: 735 bins at 44.1 kHz, 800 at 48 kHz
     public delegate void VisualizationDataHandler (float [][] pcm, float [][] spectrum);
 
     public interface IVisualizationDataSource